@@ -9,7 +9,7 @@ for i in "${!ports[@]}"; do
   peers=""
   for j in "${!ports[@]}"; do
     if [[ $j -ne $i ]]; then
-      peers+="localhost:${ports[$j]} "
+      peers+="server$((j+1))=localhost:${ports[$j]} "
     fi
   done
   echo "Launching $server_id on $addr with peers: $peers"
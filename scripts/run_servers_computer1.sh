@@ -12,10 +12,10 @@ computer2_ip="192.168.1.102"
 for i in "${!ports[@]}"; do
   server_id="server$((i+1))"
   addr="$computer1_ip:${ports[$i]}"
-  peers="$computer2_ip:50053 $computer2_ip:50054 $computer2_ip:50055" # Peers on Computer 2
+  peers="server3=$computer2_ip:50053 server4=$computer2_ip:50054 server5=$computer2_ip:50055" # Peers on Computer 2
   for j in "${!ports[@]}"; do
     if [[ $j -ne $i ]]; then
-      peers+=" $computer1_ip:${ports[$j]}" # Add other peers on Computer 1
+      peers+=" server$((j+1))=$computer1_ip:${ports[$j]}" # Add other peers on Computer 1
     fi
   done
   echo "Launching $server_id on $addr with peers: $peers"
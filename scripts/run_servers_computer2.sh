@@ -12,10 +12,10 @@ computer2_ip="192.168.1.102"
 for i in "${!ports[@]}"; do
   server_id="server$((i+3))" # Start server IDs from 3 for Computer 2
   addr="$computer2_ip:${ports[$i]}"
-  peers="$computer1_ip:50051 $computer1_ip:50052" # Peers on Computer 1
+  peers="server1=$computer1_ip:50051 server2=$computer1_ip:50052" # Peers on Computer 1
   for j in "${!ports[@]}"; do
     if [[ $j -ne $i ]]; then
-      peers+=" $computer2_ip:${ports[$j]}" # Add other peers on Computer 2
+      peers+=" server$((j+3))=$computer2_ip:${ports[$j]}" # Add other peers on Computer 2
     fi
   done
   echo "Launching $server_id on $addr with peers: $peers"
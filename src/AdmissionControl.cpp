@@ -0,0 +1,69 @@
+#include "AdmissionControl.hpp"
+#include <algorithm>
+#include <sstream>
+
+void ServiceRateEstimator::recordServiceTime(std::chrono::nanoseconds service_time) {
+    double sample_ms = service_time.count() / 1e6;
+    double current = service_time_ms_.load(std::memory_order_relaxed);
+    double updated;
+    do {
+        updated = current > 0.0 ? current + kSmoothing * (sample_ms - current) : sample_ms;
+    } while (!service_time_ms_.compare_exchange_weak(current, updated, std::memory_order_relaxed));
+}
+
+double ServiceRateEstimator::serviceRate() const {
+    double service_time_ms = serviceTimeMs();
+    int workers = workers_.load(std::memory_order_relaxed);
+    if (service_time_ms <= 0.0 || workers <= 0) return 0.0;
+    return workers * 1000.0 / service_time_ms;
+}
+
+AdmissionController::AdmissionController(bool enabled, const std::array<int, tar::Priority_ARRAYSIZE>& queue_limits)
+    : enabled_(enabled), queue_limits_(queue_limits) {}
+
+int64_t AdmissionController::estimateDelayNanos(const CandidateLoad& candidate) {
+    if (candidate.service_rate <= 0.0) return -1;
+    double seconds = candidate.tasks_ahead / candidate.service_rate + candidate.service_time_ms / 1e3;
+    return static_cast<int64_t>(seconds * 1e9);
+}
+
+AdmissionDecision AdmissionController::admit(const tar::Task& task, const CandidateLoad* candidates, size_t count,
+                                             int64_t now_wall_nanos) const {
+    AdmissionDecision decision;
+    if (!enabled_ || count == 0) return decision;
+
+    int priority = std::clamp<int>(task.priority(), 0, tar::Priority_ARRAYSIZE - 1);
+    int64_t least_ahead = candidates[0].tasks_ahead;
+    int64_t best_delay = -1;
+    for (size_t i = 0; i < count; ++i) {
+        const CandidateLoad& candidate = candidates[i];
+        least_ahead = std::min(least_ahead, candidate.tasks_ahead);
+        int64_t delay = estimateDelayNanos(candidate);
+        if (delay >= 0 && (best_delay < 0 || delay < best_delay)) best_delay = delay;
+    }
+
+    int limit = queue_limits_[priority];
+    if (limit > 0 && least_ahead >= limit) {
+        std::ostringstream reason;
+        reason << "Overloaded: " << least_ahead << " tasks queued at " << tar::Priority_Name(task.priority())
+               << " priority or above on every candidate (limit " << limit << ")";
+        decision.verdict = AdmissionDecision::kShed;
+        decision.reason = reason.str();
+        return decision;
+    }
+
+    if (task.deadline() > 0) {
+        int64_t remaining = task.deadline() - now_wall_nanos;
+        if (remaining <= 0) {
+            decision.verdict = AdmissionDecision::kDeadlineMiss;
+            decision.reason = "Deadline already passed";
+        } else if (best_delay > remaining) {
+            std::ostringstream reason;
+            reason << "Deadline cannot be met: estimated completion in " << best_delay / 1000000
+                   << " ms, " << remaining / 1000000 << " ms left";
+            decision.verdict = AdmissionDecision::kDeadlineMiss;
+            decision.reason = reason.str();
+        }
+    }
+    return decision;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "tar.pb.h"
+
+// How fast the local executor drains the queue, derived from the mean task
+// execution time (EWMA) and the number of workers. Measuring execution time
+// rather than completions per second keeps an idle server from looking slow.
+class ServiceRateEstimator {
+public:
+    void setWorkers(int workers) { workers_.store(workers, std::memory_order_relaxed); }
+    void recordServiceTime(std::chrono::nanoseconds service_time);
+
+    double serviceTimeMs() const { return service_time_ms_.load(std::memory_order_relaxed); }
+
+    // Tasks per second with every worker busy; 0 until a task has completed
+    double serviceRate() const;
+
+private:
+    static constexpr double kSmoothing = 0.05; // Weight of the newest sample
+
+    std::atomic<int> workers_{0};
+    std::atomic<double> service_time_ms_{0.0};
+};
+
+// Queue and throughput of one server a task would be queued on
+struct CandidateLoad {
+    int64_t tasks_ahead;    // Queued tasks at the task's priority or above
+    double service_rate;    // Tasks per second; 0 = unknown
+    double service_time_ms;
+};
+
+struct AdmissionDecision {
+    enum Verdict { kAdmitted, kShed, kDeadlineMiss };
+
+    Verdict verdict = kAdmitted;
+    std::string reason; // Returned to the client with RESOURCE_EXHAUSTED
+
+    bool admitted() const { return verdict == kAdmitted; }
+};
+
+// Turns tasks away before they are queued when they cannot finish in time or
+// the cluster is overloaded. A task is queued on the coordinator and on each
+// routed target and completes wherever it runs first, so both checks use the
+// least loaded of those candidates:
+//  - Load shedding: each priority has a queue limit, counted over tasks at
+//    that priority or above. LOW counts the whole queue and has the lowest
+//    limit, so it is shed first; URGENT is never shed by default.
+//  - Deadlines: the queueing delay on a candidate is estimated as
+//    tasks_ahead / service_rate plus one service time. A task whose deadline
+//    falls before the best estimate is rejected now instead of timing out in
+//    a queue. Candidates that have not measured a service rate yet are skipped.
+class AdmissionController {
+public:
+    // A limit of 0 disables shedding at that priority
+    AdmissionController(bool enabled, const std::array<int, tar::Priority_ARRAYSIZE>& queue_limits);
+
+    // now_wall_nanos is on the clock of Task::timestamp and Task::deadline.
+    // Candidates come as a plain array so routing can keep them on the stack.
+    AdmissionDecision admit(const tar::Task& task, const CandidateLoad* candidates, size_t count,
+                            int64_t now_wall_nanos) const;
+
+    // Expected time until a task queued on the candidate completes; -1 if unknown
+    static int64_t estimateDelayNanos(const CandidateLoad& candidate);
+
+private:
+    bool enabled_;
+    std::array<int, tar::Priority_ARRAYSIZE> queue_limits_;
+};
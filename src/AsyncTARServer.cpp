@@ -0,0 +1,229 @@
+#include "AsyncTARServer.hpp"
+#include "Logger.hpp"
+#include <google/protobuf/arena.h>
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+namespace {
+
+// Common interface so the polling loop can drive any call-data type
+class CallData {
+public:
+    virtual ~CallData() = default;
+    virtual void proceed(bool ok) = 0;
+};
+
+// State machine for one unary RPC: wait for a request, run the handler,
+// send the reply, then free itself. A fresh instance is posted as soon as a
+// request arrives so the queue always has a call waiting. Requests are parsed
+// into a per-call arena, so their sub-messages and strings are released in one
+// go with the call instead of one allocation at a time.
+template <class Request, class Response>
+class UnaryCallData final : public CallData {
+public:
+    using RequestMethod = void (AsyncEngineService::*)(
+        grpc::ServerContext*, Request*, grpc::ServerAsyncResponseWriter<Response>*,
+        grpc::CompletionQueue*, grpc::ServerCompletionQueue*, void*);
+    using HandlerMethod = grpc::Status (TARServiceImpl::*)(
+        grpc::ServerContext*, const Request*, Response*);
+
+    // A non-null server runs the handler on its blocking pool instead of the polling thread
+    UnaryCallData(AsyncEngineService* service, grpc::ServerCompletionQueue* cq,
+                  TARServiceImpl* handler, RequestMethod request_method, HandlerMethod handler_method,
+                  AsyncTARServer* blocking)
+        : service_(service), cq_(cq), handler_(handler),
+          request_method_(request_method), handler_method_(handler_method), blocking_(blocking),
+          request_(google::protobuf::Arena::CreateMessage<Request>(&arena_)), responder_(&context_) {
+        (service_->*request_method_)(&context_, request_, &responder_, cq_, cq_, this);
+    }
+
+    void proceed(bool ok) override {
+        if (!ok || state_ == State::FINISH) {
+            // Either the server is shutting down or the reply has been sent
+            delete this;
+            return;
+        }
+
+        // Keep a call posted for the next client before handling this one
+        new UnaryCallData(service_, cq_, handler_, request_method_, handler_method_, blocking_);
+
+        if (blocking_) {
+            blocking_->runBlocking([this] { handle(); });
+        } else {
+            handle();
+        }
+    }
+
+private:
+    void handle() {
+        grpc::Status status = (handler_->*handler_method_)(&context_, request_, &response_);
+        state_ = State::FINISH;
+        responder_.Finish(response_, status, this);
+    }
+
+    enum class State { PROCESS, FINISH };
+
+    AsyncEngineService* service_;
+    grpc::ServerCompletionQueue* cq_;
+    TARServiceImpl* handler_;
+    RequestMethod request_method_;
+    HandlerMethod handler_method_;
+    AsyncTARServer* blocking_;
+
+    grpc::ServerContext context_;
+    google::protobuf::Arena arena_;
+    Request* request_; // Owned by arena_
+    Response response_; // Heap-backed so handlers can move queued tasks into it
+    grpc::ServerAsyncResponseWriter<Response> responder_;
+    State state_ = State::PROCESS;
+};
+
+template <class Request, class Response>
+void PostCall(AsyncEngineService* service, grpc::ServerCompletionQueue* cq, TARServiceImpl* handler,
+              typename UnaryCallData<Request, Response>::RequestMethod request_method,
+              typename UnaryCallData<Request, Response>::HandlerMethod handler_method,
+              AsyncTARServer* blocking = nullptr) {
+    new UnaryCallData<Request, Response>(service, cq, handler, request_method, handler_method, blocking);
+}
+
+} // namespace
+
+AsyncTARServer::AsyncTARServer(TARServiceImpl* handler, int num_cqs, int threads_per_cq, bool pin_threads,
+                               int blocking_threads)
+    : handler_(handler),
+      num_cqs_(std::max(1, num_cqs)),
+      threads_per_cq_(std::max(1, threads_per_cq)),
+      pin_threads_(pin_threads),
+      num_blocking_threads_(std::max(1, blocking_threads)) {}
+
+AsyncTARServer::~AsyncTARServer() {
+    shutdown();
+}
+
+void AsyncTARServer::configure(grpc::ServerBuilder& builder) {
+    builder.RegisterService(&service_);
+    for (int i = 0; i < num_cqs_; ++i) {
+        cqs_.push_back(builder.AddCompletionQueue());
+    }
+}
+
+void AsyncTARServer::start() {
+    using AsyncService = AsyncEngineService;
+
+    service_.setHandler(handler_);
+    for (int i = 0; i < num_blocking_threads_; ++i) {
+        blocking_threads_.emplace_back(&AsyncTARServer::blockingLoop, this);
+    }
+
+    for (auto& cq : cqs_) {
+        // One outstanding call per polling thread and RPC keeps every thread busy
+        for (int i = 0; i < threads_per_cq_; ++i) {
+            PostCall<tar::RouteTaskRequest, tar::RouteTaskResponse>(
+                &service_, cq.get(), handler_, &AsyncService::RequestRouteTask, &TARServiceImpl::RouteTask, this);
+            PostCall<tar::RouteTaskBatchRequest, tar::RouteTaskBatchResponse>(
+                &service_, cq.get(), handler_, &AsyncService::RequestRouteTaskBatch, &TARServiceImpl::RouteTaskBatch, this);
+            PostCall<tar::ServerMetrics, tar::ServerMetrics>(
+                &service_, cq.get(), handler_, &AsyncService::RequestHeartbeat, &TARServiceImpl::Heartbeat);
+            PostCall<tar::GossipMessage, tar::GossipMessage>(
+                &service_, cq.get(), handler_, &AsyncService::RequestGossip, &TARServiceImpl::Gossip);
+            PostCall<tar::TaskAck, tar::TaskAck>(
+                &service_, cq.get(), handler_, &AsyncService::RequestAcknowledgeTask, &TARServiceImpl::AcknowledgeTask);
+            PostCall<tar::ServerMetrics, tar::Task>(
+                &service_, cq.get(), handler_, &AsyncService::RequestRequestTaskTransfer, &TARServiceImpl::RequestTaskTransfer);
+            PostCall<tar::StealRequest, tar::TaskBatch>(
+                &service_, cq.get(), handler_, &AsyncService::RequestStealTasks, &TARServiceImpl::StealTasks);
+            PostCall<tar::TaskBatch, tar::TaskAckBatch>(
+                &service_, cq.get(), handler_, &AsyncService::RequestReplicateTasks, &TARServiceImpl::ReplicateTasks);
+            PostCall<tar::StatsRequest, tar::StatsResponse>(
+                &service_, cq.get(), handler_, &AsyncService::RequestGetStats, &TARServiceImpl::GetStats);
+        }
+    }
+
+#ifdef __linux__
+    unsigned int num_cores = std::max(1u, std::thread::hardware_concurrency());
+#else
+    if (pin_threads_) {
+        // No portable affinity API (macOS only offers scheduler hints)
+        LOG_WARN("Server", "ASYNC_SERVER_PIN_THREADS is only supported on Linux; polling threads are not pinned");
+        pin_threads_ = false;
+    }
+#endif
+
+    for (auto& cq : cqs_) {
+        for (int i = 0; i < threads_per_cq_; ++i) {
+            threads_.emplace_back(&AsyncTARServer::pollLoop, this, cq.get());
+
+#ifdef __linux__
+            if (pin_threads_) {
+                cpu_set_t cpuset;
+                CPU_ZERO(&cpuset);
+                CPU_SET((threads_.size() - 1) % num_cores, &cpuset);
+                pthread_setaffinity_np(threads_.back().native_handle(), sizeof(cpu_set_t), &cpuset);
+            }
+#endif
+        }
+    }
+
+    LOG_INFO("Server", "Async engine running with ", cqs_.size(), " completion queues, ",
+             threads_.size(), " polling threads", (pin_threads_ ? " (pinned)" : ""),
+             ", ", blocking_threads_.size(), " routing workers");
+}
+
+void AsyncTARServer::shutdown() {
+    if (cqs_.empty()) return;
+
+    // Finish the routing calls still in the pool while the queues can take their replies
+    {
+        std::lock_guard<std::mutex> lock(blocking_mutex_);
+        blocking_stopping_ = true;
+    }
+    blocking_cv_.notify_all();
+    for (auto& thread : blocking_threads_) {
+        thread.join();
+    }
+    blocking_threads_.clear();
+
+    for (auto& cq : cqs_) {
+        cq->Shutdown();
+    }
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+    cqs_.clear();
+}
+
+void AsyncTARServer::pollLoop(grpc::ServerCompletionQueue* cq) {
+    void* tag;
+    bool ok;
+    while (cq->Next(&tag, &ok)) {
+        static_cast<CallData*>(tag)->proceed(ok);
+    }
+}
+
+void AsyncTARServer::runBlocking(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(blocking_mutex_);
+        if (!blocking_stopping_) {
+            blocking_jobs_.push_back(std::move(job));
+            blocking_cv_.notify_one();
+            return;
+        }
+    }
+    job();
+}
+
+void AsyncTARServer::blockingLoop() {
+    std::unique_lock<std::mutex> lock(blocking_mutex_);
+    while (true) {
+        blocking_cv_.wait(lock, [this] { return blocking_stopping_ || !blocking_jobs_.empty(); });
+        if (blocking_jobs_.empty()) return; // Stopping and drained
+
+        auto job = std::move(blocking_jobs_.front());
+        blocking_jobs_.pop_front();
+        lock.unlock();
+        job();
+        lock.lock();
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "TARServiceImpl.hpp"
+#include "tar.grpc.pb.h"
+#include <grpcpp/grpcpp.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Unary RPCs are served from completion queues. SubmitTasks is a long-lived,
+// self-paced stream, so it stays on gRPC's sync pool and is forwarded as-is.
+class SyncStreamingService : public tar::TARService::Service {
+public:
+    void setHandler(TARServiceImpl* handler) { handler_ = handler; }
+
+    grpc::Status SubmitTasks(grpc::ServerContext* context,
+                             grpc::ServerReaderWriter<tar::RouteTaskResponse, tar::Task>* stream) override {
+        return handler_->SubmitTasks(context, stream);
+    }
+
+private:
+    TARServiceImpl* handler_ = nullptr;
+};
+
+using AsyncEngineService =
+    tar::TARService::WithAsyncMethod_RouteTask<
+    tar::TARService::WithAsyncMethod_RouteTaskBatch<
+    tar::TARService::WithAsyncMethod_AcknowledgeTask<
+    tar::TARService::WithAsyncMethod_Heartbeat<
+    tar::TARService::WithAsyncMethod_Gossip<
+    tar::TARService::WithAsyncMethod_RequestTaskTransfer<
+    tar::TARService::WithAsyncMethod_StealTasks<
+    tar::TARService::WithAsyncMethod_ReplicateTasks<
+    tar::TARService::WithAsyncMethod_GetStats<SyncStreamingService>>>>>>>>>;
+
+// Completion-queue based engine for TARService. Each RPC is served by its own
+// call-data state machine and the request handling itself is delegated to
+// TARServiceImpl, so sync and async modes share identical semantics.
+// RouteTask and RouteTaskBatch wait for the log flush and the replica quorum,
+// so they run on a separate worker pool; the polling threads only run handlers
+// that never block, and a slow replica cannot delay heartbeats behind it.
+class AsyncTARServer {
+public:
+    AsyncTARServer(TARServiceImpl* handler, int num_cqs, int threads_per_cq, bool pin_threads,
+                   int blocking_threads);
+    ~AsyncTARServer();
+
+    // Register the async service and its completion queues before BuildAndStart
+    void configure(grpc::ServerBuilder& builder);
+
+    // Post the initial calls and launch the polling threads after BuildAndStart
+    void start();
+
+    // Drain and join; must be called after grpc::Server::Shutdown
+    void shutdown();
+
+    // Run a handler that may block on the worker pool (inline once shutting down)
+    void runBlocking(std::function<void()> job);
+
+private:
+    void pollLoop(grpc::ServerCompletionQueue* cq);
+    void blockingLoop();
+
+    TARServiceImpl* handler_;
+    AsyncEngineService service_;
+    int num_cqs_;
+    int threads_per_cq_;
+    bool pin_threads_;
+    std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> cqs_;
+    std::vector<std::thread> threads_;
+
+    int num_blocking_threads_;
+    std::mutex blocking_mutex_;
+    std::condition_variable blocking_cv_;
+    std::deque<std::function<void()>> blocking_jobs_;
+    bool blocking_stopping_ = false;
+    std::vector<std::thread> blocking_threads_;
+};
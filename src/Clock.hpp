@@ -0,0 +1,34 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Time source for the routing core. Servers use the real clocks; the
+// simulator substitutes a virtual clock so its runs are deterministic.
+class ClockSource {
+public:
+    virtual ~ClockSource() = default;
+
+    // Monotonic time, used for failure detection
+    virtual std::chrono::steady_clock::time_point now() const = 0;
+
+    // Nanoseconds since the epoch, the unit of ServerMetrics::last_heartbeat
+    virtual int64_t wallNanos() const = 0;
+
+    static const ClockSource& real();
+};
+
+class RealClock final : public ClockSource {
+public:
+    std::chrono::steady_clock::time_point now() const override { return std::chrono::steady_clock::now(); }
+    int64_t wallNanos() const override {
+        // system_clock ticks are nanoseconds on libstdc++ but microseconds on libc++
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+};
+
+inline const ClockSource& ClockSource::real() {
+    static const RealClock clock;
+    return clock;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdlib> // For std::getenv
+#include <string>
+
+// Helper function to get environment variable or default value
+inline int GetEnvOrDefault(const char* env_var, int default_value) {
+    const char* value = std::getenv(env_var);
+    return value ? std::stoi(value) : default_value;
+}
+
+inline std::string GetEnvOrDefault(const char* env_var, const char* default_value) {
+    const char* value = std::getenv(env_var);
+    return value ? value : default_value;
+}
@@ -0,0 +1,78 @@
+#include "FailureDetector.hpp"
+#include <algorithm>
+#include <cmath>
+
+PhiAccrualDetector::PhiAccrualDetector(double threshold,
+                                       std::chrono::milliseconds expected_interval,
+                                       std::chrono::milliseconds min_stddev,
+                                       std::chrono::milliseconds acceptable_pause,
+                                       size_t window_size)
+    : threshold_(threshold),
+      expected_interval_ms_(std::max<double>(1.0, expected_interval.count())),
+      min_stddev_ms_(std::max<double>(1.0, min_stddev.count())),
+      acceptable_pause_ms_(std::max<double>(0.0, acceptable_pause.count())),
+      window_size_(std::max<size_t>(2, window_size)) {
+    // phiForDeviation is increasing, so bisect once for the threshold crossing
+    double low = -10.0, high = 40.0;
+    for (int i = 0; i < 100; ++i) {
+        double mid = (low + high) / 2;
+        (phiForDeviation(mid) < threshold_ ? low : high) = mid;
+    }
+    threshold_deviation_ = high;
+}
+
+double PhiAccrualDetector::phiForDeviation(double y) {
+    // Logistic approximation of the normal CDF, as used by Akka and Cassandra
+    double e = std::exp(-y * (1.5976 + 0.070566 * y * y));
+    return y > 0 ? -std::log10(e / (1.0 + e)) : -std::log10(1.0 - 1.0 / (1.0 + e));
+}
+
+void PhiAccrualDetector::addInterval(History& history, double interval_ms) {
+    history.intervals_ms.push_back(interval_ms);
+    history.sum += interval_ms;
+    history.sum_squares += interval_ms * interval_ms;
+    if (history.intervals_ms.size() > window_size_) {
+        double oldest = history.intervals_ms.front();
+        history.intervals_ms.pop_front();
+        history.sum -= oldest;
+        history.sum_squares -= oldest * oldest;
+    }
+}
+
+double PhiAccrualDetector::meanMs(const History& history) const {
+    return history.sum / history.intervals_ms.size();
+}
+
+double PhiAccrualDetector::stddevMs(const History& history) const {
+    double mean = meanMs(history);
+    double variance = history.sum_squares / history.intervals_ms.size() - mean * mean;
+    return std::max(min_stddev_ms_, std::sqrt(std::max(0.0, variance)));
+}
+
+PhiAccrualDetector::Clock::time_point PhiAccrualDetector::heartbeat(const std::string& peer, Clock::time_point now) {
+    auto [it, first] = histories_.try_emplace(peer);
+    History& history = it->second;
+
+    if (first) {
+        // Seed with the configured cadence until real samples replace it
+        double spread = expected_interval_ms_ / 4;
+        addInterval(history, expected_interval_ms_ - spread);
+        addInterval(history, expected_interval_ms_ + spread);
+    } else {
+        addInterval(history, std::chrono::duration<double, std::milli>(now - history.last).count());
+    }
+    history.last = now;
+
+    double suspect_after_ms = meanMs(history) + acceptable_pause_ms_ + threshold_deviation_ * stddevMs(history);
+    return now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(suspect_after_ms));
+}
+
+double PhiAccrualDetector::phi(const std::string& peer, Clock::time_point now) const {
+    auto it = histories_.find(peer);
+    if (it == histories_.end()) return 0.0;
+
+    const History& history = it->second;
+    double elapsed_ms = std::chrono::duration<double, std::milli>(now - history.last).count();
+    double y = (elapsed_ms - meanMs(history) - acceptable_pause_ms_) / stddevMs(history);
+    return phiForDeviation(y);
+}
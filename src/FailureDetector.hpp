@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+// Phi-accrual failure detector (Hayashibara et al.). Inter-arrival times of
+// each peer's heartbeats are modelled as a normal distribution; phi is the
+// -log10 probability that a heartbeat this late would still arrive, so the
+// suspicion level adapts to each peer's actual cadence and jitter.
+//
+// Because phi only grows while no heartbeat arrives, every heartbeat yields the
+// exact time the peer will cross the threshold. Callers can store that instant
+// and check it with a clock read, without consulting the detector again.
+//
+// Not thread-safe: callers serialize access.
+class PhiAccrualDetector {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // acceptable_pause is added to the expected interval so short stalls
+    // (GC, CPU contention, a slow tick) do not raise suspicion on their own
+    PhiAccrualDetector(double threshold,
+                       std::chrono::milliseconds expected_interval,
+                       std::chrono::milliseconds min_stddev,
+                       std::chrono::milliseconds acceptable_pause,
+                       size_t window_size);
+
+    // Record a heartbeat and return the time at which the peer becomes
+    // suspected unless another heartbeat arrives first
+    Clock::time_point heartbeat(const std::string& peer, Clock::time_point now);
+
+    // Current suspicion level; 0 for peers never heard from
+    double phi(const std::string& peer, Clock::time_point now) const;
+
+private:
+    struct History {
+        std::deque<double> intervals_ms;
+        double sum = 0.0;
+        double sum_squares = 0.0;
+        Clock::time_point last;
+    };
+
+    // phi for a delay of y standard deviations past the expected arrival
+    static double phiForDeviation(double y);
+
+    void addInterval(History& history, double interval_ms);
+    double meanMs(const History& history) const;
+    double stddevMs(const History& history) const;
+
+    double threshold_;
+    double threshold_deviation_; // y at which phi reaches threshold_
+    double expected_interval_ms_;
+    double min_stddev_ms_;
+    double acceptable_pause_ms_;
+    size_t window_size_;
+    std::unordered_map<std::string, History> histories_;
+};
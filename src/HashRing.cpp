@@ -0,0 +1,46 @@
+#include "HashRing.hpp"
+#include <algorithm>
+
+HashRing::HashRing(int vnodes) : vnodes_(std::max(1, vnodes)) {}
+
+uint64_t HashRing::hash(const char* data, size_t length) {
+    // FNV-1a followed by the MurmurHash3 finalizer, which spreads the nearly
+    // identical virtual node labels evenly around the ring
+    uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i < length; ++i) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= 1099511628211ull;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+uint32_t HashRing::add(const std::string& name) {
+    uint32_t member = static_cast<uint32_t>(member_names_.size());
+    member_names_.push_back(name);
+
+    // Merge the new member's points into the sorted ring in one pass
+    std::vector<Point> added;
+    added.reserve(vnodes_);
+    for (int i = 0; i < vnodes_; ++i) {
+        std::string label = name + "#" + std::to_string(i);
+        added.push_back(Point{hash(label), member});
+    }
+    auto by_hash = [](const Point& a, const Point& b) { return a.hash < b.hash; };
+    std::sort(added.begin(), added.end(), by_hash);
+
+    size_t middle = points_.size();
+    points_.insert(points_.end(), added.begin(), added.end());
+    std::inplace_merge(points_.begin(), points_.begin() + middle, points_.end(), by_hash);
+    return member;
+}
+
+size_t HashRing::firstPointAtOrAfter(uint64_t key_hash) const {
+    auto it = std::lower_bound(points_.begin(), points_.end(), key_hash,
+                               [](const Point& point, uint64_t value) { return point.hash < value; });
+    return it == points_.end() ? 0 : static_cast<size_t>(it - points_.begin());
+}
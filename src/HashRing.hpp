@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Consistent-hash ring with virtual nodes. Each member owns vnodes points,
+// placed by hashing "<name>#<i>", so every server that builds a ring over the
+// same names agrees on where a key lands. Adding a member only inserts its own
+// points and takes over about 1/n of the keys; nothing else moves.
+//
+// Members are identified by the index returned from add(). Not thread-safe:
+// callers publish immutable copies, like the peer metrics snapshot.
+class HashRing {
+public:
+    explicit HashRing(int vnodes);
+
+    uint32_t add(const std::string& name);
+
+    size_t members() const { return member_names_.size(); }
+    const std::string& memberName(uint32_t member) const { return member_names_[member]; }
+    bool empty() const { return points_.empty(); }
+
+    // Calls visit(member) for every point clockwise from key_hash, wrapping
+    // around once, until it returns false. Members appear once per virtual
+    // node, so callers that want distinct members skip repeats.
+    template <typename Visit>
+    void walk(uint64_t key_hash, Visit&& visit) const {
+        if (points_.empty()) return;
+        size_t start = firstPointAtOrAfter(key_hash);
+        for (size_t step = 0; step < points_.size(); ++step) {
+            if (!visit(points_[(start + step) % points_.size()].member)) return;
+        }
+    }
+
+    // Stable across processes and platforms (unlike std::hash)
+    static uint64_t hash(const char* data, size_t length);
+    static uint64_t hash(const std::string& key) { return hash(key.data(), key.size()); }
+
+private:
+    struct Point {
+        uint64_t hash;
+        uint32_t member;
+    };
+
+    size_t firstPointAtOrAfter(uint64_t key_hash) const;
+
+    int vnodes_;
+    std::vector<Point> points_; // Sorted by hash
+    std::vector<std::string> member_names_;
+};
@@ -0,0 +1,140 @@
+#include "Logger.hpp"
+#include "EnvConfig.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+
+namespace {
+
+const char* LevelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug: return "DEBUG";
+        case LogLevel::Info: return "INFO";
+        case LogLevel::Warn: return "WARN";
+        case LogLevel::Error: return "ERROR";
+    }
+    return "?";
+}
+
+void FormatTime(std::ostream& out, std::chrono::system_clock::time_point time) {
+    std::time_t seconds = std::chrono::system_clock::to_time_t(time);
+    auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count() % 1000;
+    std::tm local{};
+    localtime_r(&seconds, &local);
+
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%H:%M:%S", &local);
+    char millis_buffer[8];
+    std::snprintf(millis_buffer, sizeof(millis_buffer), ".%03d", static_cast<int>(millis));
+    out << buffer << millis_buffer;
+}
+
+} // namespace
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+    : level_(GetEnvOrDefault("LOG_LEVEL", static_cast<int>(LogLevel::Info))),
+      flush_interval_(std::max(1, GetEnvOrDefault("LOG_FLUSH_INTERVAL_MS", 10))) {
+    drain_thread_ = std::thread(&Logger::drainLoop, this);
+}
+
+Logger::~Logger() {
+    stopping_ = true;
+    drain_thread_.join();
+    flush();
+}
+
+Logger::Ring* Logger::ringForThisThread() {
+    thread_local ThreadRing holder;
+    if (!holder.ring) {
+        // Once per thread; the ring stays owned by the logger so records
+        // written just before the thread exits are still drained
+        auto ring = std::make_unique<Ring>();
+        holder.ring = ring.get();
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        rings_.push_back(std::move(ring));
+    }
+    return holder.ring;
+}
+
+void Logger::drainLoop() {
+    while (!stopping_) {
+        std::this_thread::sleep_for(flush_interval_);
+        flush();
+    }
+}
+
+void Logger::flush() {
+    std::lock_guard<std::mutex> lock(drain_mutex_);
+    drainOnce();
+}
+
+size_t Logger::drainOnce() {
+    struct Pending {
+        Ring* ring;
+        Record* record;
+    };
+    std::vector<Pending> pending;
+    std::vector<std::pair<Ring*, size_t>> consumed; // ring -> new tail
+
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        for (auto& ring : rings_) {
+            size_t tail = ring->tail.load(std::memory_order_relaxed);
+            size_t head = ring->head.load(std::memory_order_acquire);
+            for (size_t i = tail; i != head; ++i) {
+                pending.push_back({ring.get(), &ring->records[i & (kRingSize - 1)]});
+            }
+            consumed.emplace_back(ring.get(), head);
+        }
+    }
+
+    // Interleave the threads' records in the order they were logged
+    std::stable_sort(pending.begin(), pending.end(),
+                     [](const Pending& a, const Pending& b) { return a.record->time < b.record->time; });
+
+    std::ostringstream out;
+    std::ostringstream err;
+    for (const auto& entry : pending) {
+        Record& record = *entry.record;
+        std::ostream& stream = record.level >= LogLevel::Warn ? static_cast<std::ostream&>(err) : out;
+        FormatTime(stream, record.time);
+        stream << " " << LevelName(record.level) << " [" << record.tag << "] ";
+        record.format(stream, record.payload);
+        stream << '\n';
+        record.destroy(record.payload);
+    }
+
+    uint64_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        err << "WARN [Logger] Dropped " << dropped << " records: log rings were full\n";
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        for (auto& [ring, tail] : consumed) {
+            ring->tail.store(tail, std::memory_order_release);
+        }
+        // Forget rings of exited threads once they are empty
+        rings_.erase(std::remove_if(rings_.begin(), rings_.end(), [](const std::unique_ptr<Ring>& ring) {
+                         return ring->orphaned.load(std::memory_order_acquire) &&
+                                ring->tail.load(std::memory_order_relaxed) == ring->head.load(std::memory_order_acquire);
+                     }),
+                     rings_.end());
+    }
+
+    std::string text = out.str();
+    if (!text.empty()) {
+        std::fwrite(text.data(), 1, text.size(), stdout);
+        std::fflush(stdout);
+    }
+    text = err.str();
+    if (!text.empty()) {
+        std::fwrite(text.data(), 1, text.size(), stderr);
+    }
+    return pending.size();
+}
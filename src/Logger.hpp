@@ -0,0 +1,165 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+enum class LogLevel : int { Debug = 0, Info = 1, Warn = 2, Error = 3 };
+
+// Asynchronous logger. Each thread appends records to its own single-producer
+// ring buffer; a background thread drains all rings, formats the records and
+// writes them in one batch per cycle. Arguments are captured by value and only
+// formatted on the drain thread, so logging on a hot path costs a level check,
+// a few copies and two atomic operations: no locks, no allocation for short
+// strings and no syscalls. When a ring is full the record is dropped and
+// counted instead of blocking the caller.
+//
+// Configured with LOG_LEVEL (0 = DEBUG ... 3 = ERROR, default 1) and
+// LOG_FLUSH_INTERVAL_MS (default 10).
+class Logger {
+public:
+    static Logger& instance();
+
+    static bool enabled(LogLevel level) {
+        return static_cast<int>(level) >= instance().level_.load(std::memory_order_relaxed);
+    }
+    void setLevel(LogLevel level) { level_.store(static_cast<int>(level), std::memory_order_relaxed); }
+
+    template <class... Args>
+    void log(LogLevel level, const char* tag, Args&&... args);
+
+    // Write everything logged so far; used at shutdown
+    void flush();
+
+    ~Logger();
+
+private:
+    static constexpr size_t kRingSize = 1024; // Records per thread, power of two
+    static constexpr size_t kPayloadSize = 160;
+
+    struct Record {
+        std::chrono::system_clock::time_point time;
+        LogLevel level;
+        const char* tag;
+        void (*format)(std::ostream&, const void*);
+        void (*destroy)(void*);
+        alignas(std::max_align_t) unsigned char payload[kPayloadSize];
+    };
+
+    // Single producer (the owning thread), single consumer (the drain thread)
+    struct Ring {
+        std::array<Record, kRingSize> records;
+        alignas(64) std::atomic<size_t> head{0}; // Next slot to write
+        alignas(64) std::atomic<size_t> tail{0}; // Next slot to read
+        std::atomic<bool> orphaned{false};       // Owning thread has exited
+    };
+
+    // Detaches the thread's ring when the thread exits
+    struct ThreadRing {
+        Ring* ring = nullptr;
+        ~ThreadRing() {
+            if (ring) ring->orphaned.store(true, std::memory_order_release);
+        }
+    };
+
+    Logger();
+
+    // Argument storage: string literals stay pointers, every other C string is
+    // copied because it may not outlive the call
+    template <class Arg>
+    using Stored = std::conditional_t<
+        std::is_array_v<std::remove_reference_t<Arg>>, const char*,
+        std::conditional_t<std::is_convertible_v<std::decay_t<Arg>, const char*>, std::string, std::decay_t<Arg>>>;
+
+    Ring* ringForThisThread();
+    void drainLoop();
+    size_t drainOnce();
+
+    std::atomic<int> level_;
+    std::chrono::milliseconds flush_interval_;
+    std::atomic<uint64_t> dropped_{0};
+
+    std::mutex rings_mutex_; // Only taken to register a thread or by the drainer
+    std::vector<std::unique_ptr<Ring>> rings_;
+    std::mutex drain_mutex_;
+    std::atomic<bool> stopping_{false};
+    std::thread drain_thread_;
+};
+
+template <class... Args>
+void Logger::log(LogLevel level, const char* tag, Args&&... args) {
+    Ring* ring = ringForThisThread();
+    size_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= kRingSize) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Record& record = ring->records[head & (kRingSize - 1)];
+    record.time = std::chrono::system_clock::now();
+    record.level = level;
+    record.tag = tag;
+
+    using Captured = std::tuple<Stored<Args>...>;
+    if constexpr (sizeof(Captured) <= kPayloadSize && alignof(Captured) <= alignof(std::max_align_t)) {
+        new (record.payload) Captured(std::forward<Args>(args)...);
+        record.format = [](std::ostream& out, const void* payload) {
+            std::apply([&](const auto&... values) { (out << ... << values); }, *static_cast<const Captured*>(payload));
+        };
+        record.destroy = [](void* payload) { static_cast<Captured*>(payload)->~Captured(); };
+    } else {
+        // Too large to defer: format it now instead
+        std::ostringstream message;
+        (message << ... << args);
+        new (record.payload) std::string(message.str());
+        record.format = [](std::ostream& out, const void* payload) { out << *static_cast<const std::string*>(payload); };
+        record.destroy = [](void* payload) { static_cast<std::string*>(payload)->~basic_string(); };
+    }
+
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+// Logs a container as space-separated items, e.g. LOG_INFO("Server", "targets: ", LogList(targets))
+template <class Container>
+struct LogListOf {
+    Container items;
+
+    friend std::ostream& operator<<(std::ostream& out, const LogListOf& list) {
+        const char* separator = "";
+        for (const auto& item : list.items) {
+            out << separator << item;
+            separator = " ";
+        }
+        return out;
+    }
+};
+
+template <class Container>
+LogListOf<std::decay_t<Container>> LogList(Container&& items) {
+    return {std::forward<Container>(items)};
+}
+
+#define TAR_LOG(level, tag, ...)                                      \
+    do {                                                              \
+        if (Logger::enabled(level)) {                                 \
+            Logger::instance().log(level, tag, __VA_ARGS__);          \
+        }                                                             \
+    } while (0)
+
+#define LOG_DEBUG(tag, ...) TAR_LOG(LogLevel::Debug, tag, __VA_ARGS__)
+#define LOG_INFO(tag, ...) TAR_LOG(LogLevel::Info, tag, __VA_ARGS__)
+#define LOG_WARN(tag, ...) TAR_LOG(LogLevel::Warn, tag, __VA_ARGS__)
+#define LOG_ERROR(tag, ...) TAR_LOG(LogLevel::Error, tag, __VA_ARGS__)
@@ -0,0 +1,108 @@
+#include "MetricsGossip.hpp"
+#include <algorithm>
+#include <chrono>
+
+MetricsGossip::MetricsGossip(const std::string& self_id)
+    : self_id_(self_id),
+      // Start from the wall clock so a restarted node outranks its old entries
+      local_version_(std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::system_clock::now().time_since_epoch()).count()) {}
+
+void MetricsGossip::updateLocal(const tar::ServerMetrics& metrics) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry& entry = entries_[self_id_];
+    entry.metrics = metrics;
+    entry.metrics.clear_network_latency();
+    entry.version = ++local_version_;
+}
+
+void MetricsGossip::fillDigest(tar::GossipMessage& message) const {
+    message.set_sender_id(self_id_);
+    message.mutable_digest()->Reserve(entries_.size());
+    for (const auto& [id, entry] : entries_) {
+        auto* version = message.add_digest();
+        version->set_server_id(id);
+        version->set_version(entry.version);
+    }
+}
+
+void MetricsGossip::mergeLocked(const tar::GossipMessage& message, std::vector<tar::ServerMetrics>& learned) {
+    for (const auto& update : message.updates()) {
+        const std::string& id = update.metrics().server_id();
+        if (id == self_id_) continue; // Only we publish our own metrics
+
+        Entry& entry = entries_[id];
+        if (update.version() <= entry.version) continue;
+        entry.metrics = update.metrics();
+        entry.version = update.version();
+
+        learned.push_back(entry.metrics);
+        auto latency = latency_ms_.find(id);
+        learned.back().set_network_latency(latency != latency_ms_.end() ? latency->second : 0.0f);
+    }
+}
+
+tar::GossipMessage MetricsGossip::buildFor(const std::string& peer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tar::GossipMessage message;
+    fillDigest(message);
+
+    // Assume delivery; forgetPeer resets this if the round fails
+    auto& known = known_by_[peer];
+    for (const auto& [id, entry] : entries_) {
+        uint64_t& peer_version = known[id];
+        if (entry.version <= peer_version) continue;
+        peer_version = entry.version;
+
+        auto* update = message.add_updates();
+        *update->mutable_metrics() = entry.metrics;
+        update->set_version(entry.version);
+    }
+    return message;
+}
+
+tar::GossipMessage MetricsGossip::handle(const tar::GossipMessage& request, std::vector<tar::ServerMetrics>& learned) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    mergeLocked(request, learned);
+
+    std::unordered_map<std::string, uint64_t> sender_versions;
+    for (const auto& version : request.digest()) {
+        sender_versions[version.server_id()] = version.version();
+    }
+
+    tar::GossipMessage reply;
+    fillDigest(reply);
+    for (const auto& [id, entry] : entries_) {
+        auto it = sender_versions.find(id);
+        if (it != sender_versions.end() && it->second >= entry.version) continue;
+
+        auto* update = reply.add_updates();
+        *update->mutable_metrics() = entry.metrics;
+        update->set_version(entry.version);
+    }
+    return reply;
+}
+
+std::vector<tar::ServerMetrics> MetricsGossip::mergeReply(const std::string& peer, const tar::GossipMessage& reply) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<tar::ServerMetrics> learned;
+    mergeLocked(reply, learned);
+
+    // The reply's digest tells us exactly what the peer holds now
+    auto& known = known_by_[peer];
+    for (const auto& version : reply.digest()) {
+        uint64_t& peer_version = known[version.server_id()];
+        peer_version = std::max(peer_version, version.version());
+    }
+    return learned;
+}
+
+void MetricsGossip::forgetPeer(const std::string& peer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    known_by_.erase(peer);
+}
+
+void MetricsGossip::observeLatency(const std::string& server_id, float latency_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    latency_ms_[server_id] = latency_ms;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "tar.pb.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Versioned view of every node's metrics for gossip mode. Each node stamps its
+// own metrics with an increasing version; everyone else keeps the highest
+// version they have seen. For every peer we remember which versions it is known
+// to hold, so a round only carries the entries that changed since then.
+class MetricsGossip {
+public:
+    explicit MetricsGossip(const std::string& self_id);
+
+    // Publish a new version of this server's own metrics
+    void updateLocal(const tar::ServerMetrics& metrics);
+
+    // Round to send to a peer: full digest plus entries the peer lacks
+    tar::GossipMessage buildFor(const std::string& peer);
+
+    // Answer a received round with the entries newer than the sender's digest.
+    // Entries in the request that are new to us are appended to learned.
+    tar::GossipMessage handle(const tar::GossipMessage& request, std::vector<tar::ServerMetrics>& learned);
+
+    // Merge a peer's reply; returns the entries that were new to us
+    std::vector<tar::ServerMetrics> mergeReply(const std::string& peer, const tar::GossipMessage& reply);
+
+    // The round to this peer failed, so it may have missed our updates
+    void forgetPeer(const std::string& peer);
+
+    // Latency is observer-relative: it is measured locally and never gossiped
+    void observeLatency(const std::string& server_id, float latency_ms);
+
+private:
+    struct Entry {
+        tar::ServerMetrics metrics;
+        uint64_t version = 0;
+    };
+
+    // Both require mutex_ to be held
+    void fillDigest(tar::GossipMessage& message) const;
+    void mergeLocked(const tar::GossipMessage& message, std::vector<tar::ServerMetrics>& learned);
+
+    std::string self_id_;
+    uint64_t local_version_;
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_; // server id -> newest known metrics
+    std::unordered_map<std::string, std::unordered_map<std::string, uint64_t>> known_by_; // peer -> id -> version
+    std::unordered_map<std::string, float> latency_ms_;
+};
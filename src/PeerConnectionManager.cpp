@@ -0,0 +1,81 @@
+#include "PeerConnectionManager.hpp"
+#include "EnvConfig.hpp"
+#include "Logger.hpp"
+
+PeerConnectionManager::PeerConnectionManager(const std::vector<std::string>& peer_addresses)
+    : peer_addresses_(peer_addresses) {
+    // Reconnect backoff and keepalive are tunable through environment variables
+    int initial_backoff_ms = GetEnvOrDefault("PEER_RECONNECT_INITIAL_BACKOFF_MS", 1000);
+    int max_backoff_ms = GetEnvOrDefault("PEER_RECONNECT_MAX_BACKOFF_MS", 30000);
+    int keepalive_ms = GetEnvOrDefault("PEER_KEEPALIVE_MS", 20000);
+
+    grpc::ChannelArguments args;
+    args.SetInt(GRPC_ARG_INITIAL_RECONNECT_BACKOFF_MS, initial_backoff_ms);
+    args.SetInt(GRPC_ARG_MIN_RECONNECT_BACKOFF_MS, initial_backoff_ms);
+    args.SetInt(GRPC_ARG_MAX_RECONNECT_BACKOFF_MS, max_backoff_ms);
+    args.SetInt(GRPC_ARG_KEEPALIVE_TIME_MS, keepalive_ms);
+    args.SetInt(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
+
+    for (const auto& peer : peer_addresses_) {
+        if (connections_.count(peer)) continue;
+
+        PeerConnection connection;
+        connection.channel = grpc::CreateCustomChannel(peer, grpc::InsecureChannelCredentials(), args);
+        connection.stub = tar::TARService::NewStub(connection.channel);
+
+        // Start connecting now so the first heartbeat does not pay for the handshake
+        connection.channel->GetState(true);
+        connections_.emplace(peer, std::move(connection));
+    }
+
+    LOG_INFO("Peers", "Created ", connections_.size(), " persistent peer channels");
+}
+
+tar::TARService::Stub* PeerConnectionManager::getStub(const std::string& peer_address) const {
+    auto it = connections_.find(peer_address);
+    return it == connections_.end() ? nullptr : it->second.stub.get();
+}
+
+tar::TARService::Stub* PeerConnectionManager::getStubForServer(const std::string& server_id) const {
+    {
+        std::shared_lock<std::shared_mutex> lock(server_ids_mutex_);
+        auto it = server_addresses_.find(server_id);
+        if (it != server_addresses_.end()) {
+            return getStub(it->second);
+        }
+    }
+    return getStub(server_id); // Routing falls back to raw addresses before heartbeats arrive
+}
+
+void PeerConnectionManager::bindServerId(const std::string& peer_address, const std::string& server_id) {
+    {
+        std::shared_lock<std::shared_mutex> lock(server_ids_mutex_);
+        auto it = server_addresses_.find(server_id);
+        if (it != server_addresses_.end() && it->second == peer_address) return;
+    }
+    std::unique_lock<std::shared_mutex> lock(server_ids_mutex_);
+    server_addresses_[server_id] = peer_address;
+    address_server_ids_[peer_address] = server_id;
+}
+
+std::string PeerConnectionManager::getServerId(const std::string& peer_address) const {
+    std::shared_lock<std::shared_mutex> lock(server_ids_mutex_);
+    auto it = address_server_ids_.find(peer_address);
+    return it != address_server_ids_.end() ? it->second : std::string();
+}
+
+bool PeerConnectionManager::isConnected(const std::string& peer_address) const {
+    auto it = connections_.find(peer_address);
+    return it != connections_.end() &&
+           it->second.channel->GetState(false) == GRPC_CHANNEL_READY;
+}
+
+void PeerConnectionManager::refreshConnections() const {
+    for (const auto& [peer, connection] : connections_) {
+        auto state = connection.channel->GetState(false);
+        if (state == GRPC_CHANNEL_IDLE || state == GRPC_CHANNEL_TRANSIENT_FAILURE) {
+            // Requesting a connection lets gRPC retry under its configured backoff
+            connection.channel->GetState(true);
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "tar.grpc.pb.h"
+#include <grpcpp/grpcpp.h>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Owns one long-lived channel/stub per peer so heartbeats, task stealing and
+// replication reuse established HTTP/2 connections instead of dialing per call.
+class PeerConnectionManager {
+public:
+    explicit PeerConnectionManager(const std::vector<std::string>& peer_addresses);
+
+    // Returns the shared stub for a peer address, or nullptr for unknown peers
+    tar::TARService::Stub* getStub(const std::string& peer_address) const;
+
+    // Resolve a server id (learned from heartbeats) or a raw address to a stub
+    tar::TARService::Stub* getStubForServer(const std::string& server_id) const;
+
+    // Remember which server id answers at a peer address
+    void bindServerId(const std::string& peer_address, const std::string& server_id);
+
+    // Server id last seen at a peer address; empty before its first reply
+    std::string getServerId(const std::string& peer_address) const;
+
+    // True if the channel to the peer is currently READY
+    bool isConnected(const std::string& peer_address) const;
+
+    // Kick idle or failed channels so they start reconnecting (with backoff)
+    void refreshConnections() const;
+
+    const std::vector<std::string>& getPeerAddresses() const { return peer_addresses_; }
+
+private:
+    struct PeerConnection {
+        std::shared_ptr<grpc::Channel> channel;
+        std::unique_ptr<tar::TARService::Stub> stub;
+    };
+
+    std::vector<std::string> peer_addresses_;
+    // Built once in the constructor and never mutated, so lookups need no lock
+    std::unordered_map<std::string, PeerConnection> connections_;
+
+    mutable std::shared_mutex server_ids_mutex_;
+    std::unordered_map<std::string, std::string> server_addresses_; // server id -> address
+    std::unordered_map<std::string, std::string> address_server_ids_; // address -> server id
+};
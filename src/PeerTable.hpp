@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "tar.pb.h"
+
+// Dense index of a peer, assigned once (peers_ in order at startup, later
+// joiners appended) and never reused, so it can index every per-peer array.
+// Peers are named by server id, the name their metrics arrive under.
+using PeerId = uint32_t;
+
+// This server in affinity targets, where the ring places keys on every server
+// including the routing one; it has no columns in the peer table
+constexpr PeerId kSelfPeer = std::numeric_limits<PeerId>::max();
+
+// Peer ids a task is routed to, best first. Fixed capacity, so routing
+// results never allocate; names are only looked up at the gRPC boundary.
+class TargetList {
+public:
+    static constexpr size_t kCapacity = 3; // Highest replication factor (URGENT)
+
+    void push_back(PeerId id) { ids_[size_++] = id; }
+    void clear() { size_ = 0; }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    PeerId operator[](size_t i) const { return ids_[i]; }
+    const PeerId* begin() const { return ids_.data(); }
+    const PeerId* end() const { return ids_.data() + size_; }
+
+    bool contains(PeerId id) const {
+        for (size_t i = 0; i < size_; ++i) {
+            if (ids_[i] == id) return true;
+        }
+        return false;
+    }
+
+private:
+    std::array<PeerId, kCapacity> ids_;
+    uint8_t size_ = 0;
+};
+
+// Interned peer names. Append-only; replaced as a whole when a peer outside
+// the startup list joins, which is rare enough to copy.
+struct PeerDirectory {
+    std::vector<std::string> names;
+    std::unordered_map<std::string, PeerId> ids;
+
+    // Returns the existing id for name, or appends it
+    PeerId intern(const std::string& name) {
+        auto it = ids.find(name);
+        if (it != ids.end()) return it->second;
+        PeerId id = static_cast<PeerId>(names.size());
+        names.push_back(name);
+        ids.emplace(name, id);
+        return id;
+    }
+};
+
+// Where a peer sits relative to this server in hierarchical mode. Unplaced
+// peers (no zone reported and no round trip measured yet) are heartbeated
+// every tick, but only count as a last resort for routing and stealing.
+enum class PeerZone : uint8_t { kUnplaced, kSame, kOther };
+
+// Structure-of-arrays snapshot of peer state, indexed by PeerId. The routing
+// scan only touches the score and suspect_after columns (12 bytes per peer),
+// so it stays in cache for thousands of peers; full metrics messages are kept
+// cold for admission control and stealing.
+struct PeerTable {
+    std::shared_ptr<const PeerDirectory> directory;
+
+    std::vector<float> score;           // Cached routing score; recomputed only when metrics change
+    std::vector<int64_t> suspect_after; // steady_clock ticks; INT64_MIN (always suspected) until heard from
+    std::vector<int32_t> queue_length;
+    std::vector<PeerZone> zone;
+    std::vector<std::shared_ptr<const tar::ServerMetrics>> metrics; // nullptr until heard from
+
+    size_t heard = 0;               // Peers with metrics; 0 means routing falls back to peers_
+    int64_t total_queue_length = 0; // Sum of queue_length
+
+    size_t size() const { return score.size(); }
+    bool suspected(PeerId id, int64_t now_ticks) const { return now_ticks >= suspect_after[id]; }
+
+    // Extend every column to cover peers ids; new entries are never-heard-from peers
+    void resize(size_t peers) {
+        score.resize(peers, 0.0f);
+        suspect_after.resize(peers, std::numeric_limits<int64_t>::min());
+        queue_length.resize(peers, 0);
+        zone.resize(peers, PeerZone::kUnplaced);
+        metrics.resize(peers);
+    }
+};
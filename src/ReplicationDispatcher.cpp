@@ -0,0 +1,134 @@
+#include "ReplicationDispatcher.hpp"
+#include "EnvConfig.hpp"
+#include "Logger.hpp"
+
+ReplicationDispatcher::ReplicationDispatcher(const std::string& self_id,
+                                             PeerConnectionManager* peer_connections,
+                                             ReplicationTracker* tracker)
+    : self_id_(self_id),
+      peer_connections_(peer_connections),
+      tracker_(tracker),
+      rpc_deadline_ms_(GetEnvOrDefault("REPLICATION_RPC_DEADLINE_MS", 2000)),
+      quorum_timeout_(GetEnvOrDefault("REPLICATION_QUORUM_TIMEOUT_MS", 1000)),
+      lazy_batch_size_(GetEnvOrDefault("REPLICATION_LAZY_BATCH_SIZE", 64)),
+      lazy_window_(GetEnvOrDefault("REPLICATION_LAZY_WINDOW_MS", 200)) {
+    completion_thread_ = std::thread(&ReplicationDispatcher::completionLoop, this);
+    lazy_thread_ = std::thread(&ReplicationDispatcher::lazyFlushLoop, this);
+}
+
+ReplicationDispatcher::~ReplicationDispatcher() {
+    {
+        std::lock_guard<std::mutex> lock(lazy_mutex_);
+        stopping_ = true;
+    }
+    lazy_cv_.notify_one();
+    lazy_thread_.join(); // Flushes any buffered LOW replicas
+
+    cq_.Shutdown();
+    completion_thread_.join();
+}
+
+ReplicationDispatcher::Started ReplicationDispatcher::replicate(std::shared_ptr<tar::Task> task, const std::vector<std::string>& targets) {
+    std::vector<const std::string*> remote_targets;
+    for (const auto& target : targets) {
+        if (target != self_id_) remote_targets.push_back(&target); // Our own copy is already queued
+    }
+    if (remote_targets.empty()) return Started::kNoWait;
+
+    bool lazy = task->priority() == tar::Priority::LOW;
+    if (!tracker_->track(task->id(), task->priority(), remote_targets.size(), !lazy)) {
+        LOG_WARN("Replication", "Task ", task->id(), " is already being replicated; rejecting the duplicate");
+        return Started::kDuplicate;
+    }
+
+    if (lazy) {
+        std::lock_guard<std::mutex> lock(lazy_mutex_);
+        for (const auto* target : remote_targets) {
+            auto& batch = lazy_batches_[*target];
+            batch.push_back(task);
+            if (batch.size() >= lazy_batch_size_) {
+                lazy_cv_.notify_one();
+            }
+        }
+        return Started::kNoWait;
+    }
+
+    for (const auto* target : remote_targets) {
+        send(*target, SharedTasks{task});
+    }
+    return Started::kAwaitQuorum;
+}
+
+bool ReplicationDispatcher::waitForQuorum(const std::string& task_id) {
+    return tracker_->waitForQuorum(task_id, quorum_timeout_);
+}
+
+void ReplicationDispatcher::send(const std::string& target, SharedTasks tasks) {
+    auto* stub = peer_connections_->getStubForServer(target);
+    if (!stub) {
+        LOG_WARN("Replication", "No connection to ", target);
+        for (const auto& task : tasks) {
+            tracker_->recordAck(task->id(), false);
+        }
+        return;
+    }
+
+    // Owned by the completion queue until completionLoop picks it up
+    auto* call = new AsyncReplicateCall;
+    call->target = target;
+    call->borrowed = std::move(tasks);
+    call->request.mutable_tasks()->Reserve(call->borrowed.size());
+    for (const auto& task : call->borrowed) {
+        call->request.mutable_tasks()->UnsafeArenaAddAllocated(task.get());
+    }
+    call->context.set_deadline(std::chrono::system_clock::now() + std::chrono::milliseconds(rpc_deadline_ms_));
+    call->reader = stub->PrepareAsyncReplicateTasks(&call->context, call->request, &cq_);
+    call->reader->StartCall();
+    call->reader->Finish(&call->response, &call->status, call);
+}
+
+void ReplicationDispatcher::completionLoop() {
+    void* tag;
+    bool ok;
+    while (cq_.Next(&tag, &ok)) {
+        std::unique_ptr<AsyncReplicateCall> call(static_cast<AsyncReplicateCall*>(tag));
+
+        if (!call->status.ok()) {
+            LOG_WARN("Replication", "Failed to replicate to ", call->target, ": ", call->status.error_message());
+            for (const auto& task : call->request.tasks()) {
+                tracker_->recordAck(task.id(), false);
+            }
+            continue;
+        }
+
+        for (const auto& ack : call->response.acks()) {
+            tracker_->recordAck(ack.task_id(), ack.success());
+        }
+    }
+}
+
+void ReplicationDispatcher::lazyFlushLoop() {
+    std::unique_lock<std::mutex> lock(lazy_mutex_);
+    while (true) {
+        lazy_cv_.wait_for(lock, lazy_window_, [this] {
+            if (stopping_) return true;
+            for (const auto& [target, batch] : lazy_batches_) {
+                if (batch.size() >= lazy_batch_size_) return true;
+            }
+            return false;
+        });
+
+        std::unordered_map<std::string, SharedTasks> ready;
+        ready.swap(lazy_batches_);
+        bool stop = stopping_;
+        lock.unlock();
+
+        for (auto& [target, batch] : ready) {
+            LOG_DEBUG("Replication", "Sending ", batch.size(), " lazy replicas to ", target);
+            send(target, std::move(batch));
+        }
+
+        if (stop) return;
+        lock.lock();
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "PeerConnectionManager.hpp"
+#include "ReplicationTracker.hpp"
+#include "tar.grpc.pb.h"
+#include <grpcpp/grpcpp.h>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Sends replicas of routed tasks to their target servers in parallel and feeds
+// the answers into a ReplicationTracker. URGENT and MODERATE replicas go out
+// immediately; LOW replicas are buffered per target and shipped lazily in batches.
+// Outgoing requests borrow the caller's task messages instead of copying them.
+class ReplicationDispatcher {
+public:
+    ReplicationDispatcher(const std::string& self_id,
+                          PeerConnectionManager* peer_connections,
+                          ReplicationTracker* tracker);
+    ~ReplicationDispatcher();
+
+    enum class Started {
+        kNoWait,       // Nothing to wait for: no remote targets, or LOW (replicated lazily)
+        kAwaitQuorum,  // Wait for a quorum (see waitForQuorum) before answering the client
+        kDuplicate     // A task with this id is still replicating; nothing was sent
+    };
+
+    // Start replicating a task to the given targets.
+    // The task must not be modified afterwards; it is shared with in-flight RPCs.
+    Started replicate(std::shared_ptr<tar::Task> task, const std::vector<std::string>& targets);
+
+    // Wait for the task's priority-dependent quorum; true once it is reached
+    bool waitForQuorum(const std::string& task_id);
+
+private:
+    using SharedTasks = std::vector<std::shared_ptr<tar::Task>>;
+
+    // The request only points at the borrowed tasks; they are handed back
+    // before it is destroyed so the batch never owns or copies them
+    struct AsyncReplicateCall {
+        std::string target;
+        SharedTasks borrowed;
+        grpc::ClientContext context;
+        tar::TaskBatch request;
+        tar::TaskAckBatch response;
+        grpc::Status status;
+        std::unique_ptr<grpc::ClientAsyncResponseReader<tar::TaskAckBatch>> reader;
+
+        ~AsyncReplicateCall() {
+            while (!request.tasks().empty()) request.mutable_tasks()->UnsafeArenaReleaseLast();
+        }
+    };
+
+    void send(const std::string& target, SharedTasks tasks);
+    void completionLoop();
+    void lazyFlushLoop();
+
+    std::string self_id_;
+    PeerConnectionManager* peer_connections_;
+    ReplicationTracker* tracker_;
+    int rpc_deadline_ms_;
+    std::chrono::milliseconds quorum_timeout_;
+    size_t lazy_batch_size_;
+    std::chrono::milliseconds lazy_window_;
+
+    grpc::CompletionQueue cq_;
+    std::thread completion_thread_;
+
+    std::mutex lazy_mutex_;
+    std::condition_variable lazy_cv_;
+    std::unordered_map<std::string, SharedTasks> lazy_batches_; // target -> pending LOW replicas
+    bool stopping_ = false;
+    std::thread lazy_thread_;
+};
@@ -0,0 +1,92 @@
+#include "ReplicationTracker.hpp"
+#include <algorithm>
+#include <functional>
+
+int ReplicationTracker::quorumFor(tar::Priority priority, int replicas) {
+    int required = (priority == tar::Priority::URGENT) ? replicas / 2 + 1 : 1;
+    return std::min(required, replicas);
+}
+
+ReplicationTracker::Shard& ReplicationTracker::shardFor(const std::string& task_id) {
+    return shards_[std::hash<std::string>{}(task_id) % kNumShards];
+}
+
+bool ReplicationTracker::track(const std::string& task_id, tar::Priority priority, int replicas, bool await_quorum) {
+    PendingTask entry;
+    entry.submitted = std::chrono::steady_clock::now();
+    entry.priority = static_cast<uint8_t>(priority);
+    entry.replicas = static_cast<uint8_t>(replicas);
+    entry.required = static_cast<uint8_t>(quorumFor(priority, replicas));
+    entry.awaited = await_quorum;
+
+    Shard& shard = shardFor(task_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    // Acks carry only the task id, so two submissions of one id cannot be told apart
+    return shard.pending.emplace(task_id, entry).second;
+}
+
+bool ReplicationTracker::recordAck(const std::string& task_id, bool success) {
+    Shard& shard = shardFor(task_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.pending.find(task_id);
+    if (it == shard.pending.end()) return false;
+
+    PendingTask& entry = it->second;
+    if (success) {
+        ++entry.acked;
+        if (entry.acked == entry.required) {
+            recordQuorumLatency(entry);
+        }
+    } else {
+        ++entry.failed;
+    }
+
+    if (entry.acked + entry.failed >= entry.replicas && !entry.awaited) {
+        shard.pending.erase(it); // Every replica answered and nobody is waiting
+    }
+    shard.cv.notify_all();
+    return true;
+}
+
+bool ReplicationTracker::waitForQuorum(const std::string& task_id, std::chrono::milliseconds timeout) {
+    Shard& shard = shardFor(task_id);
+    std::unique_lock<std::mutex> lock(shard.mutex);
+
+    if (shard.pending.find(task_id) == shard.pending.end()) return false;
+
+    // Never hold an iterator across the wait: other tasks in the shard come and go
+    shard.cv.wait_for(lock, timeout, [&] {
+        auto it = shard.pending.find(task_id);
+        if (it == shard.pending.end()) return true;
+        const PendingTask& entry = it->second;
+        return entry.acked >= entry.required || entry.replicas - entry.failed < entry.required;
+    });
+
+    auto it = shard.pending.find(task_id);
+    if (it == shard.pending.end()) return false; // Released by someone else: not ours to commit
+    bool committed = it->second.acked >= it->second.required;
+    shard.pending.erase(it); // Late acks for this task are ignored
+    return committed;
+}
+
+void ReplicationTracker::recordQuorumLatency(const PendingTask& entry) {
+    uint64_t elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - entry.submitted).count();
+
+    AtomicLatency& stats = latency_[entry.priority];
+    stats.count.fetch_add(1, std::memory_order_relaxed);
+    stats.total_us.fetch_add(elapsed_us, std::memory_order_relaxed);
+    uint64_t current_max = stats.max_us.load(std::memory_order_relaxed);
+    while (elapsed_us > current_max &&
+           !stats.max_us.compare_exchange_weak(current_max, elapsed_us, std::memory_order_relaxed)) {}
+}
+
+ReplicationTracker::LatencyStats ReplicationTracker::quorumLatency(tar::Priority priority) const {
+    const AtomicLatency& stats = latency_[priority];
+    LatencyStats result;
+    result.count = stats.count.load(std::memory_order_relaxed);
+    result.total_us = stats.total_us.load(std::memory_order_relaxed);
+    result.max_us = stats.max_us.load(std::memory_order_relaxed);
+    return result;
+}
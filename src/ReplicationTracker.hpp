@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "tar.pb.h"
+
+// Per-task replica acknowledgement state, keyed by task id. Entries are a few
+// bytes each and live only until every replica has answered (or the waiter
+// gives up), so the table stays proportional to in-flight replications.
+class ReplicationTracker {
+public:
+    // Acks needed before a task counts as committed: URGENT needs a majority of
+    // its replicas (2 of 3), MODERATE and LOW need one
+    static int quorumFor(tar::Priority priority, int replicas);
+
+    // Start tracking a task sent to `replicas` servers. When await_quorum is set
+    // the entry is kept until waitForQuorum collects it; otherwise it is dropped
+    // as soon as every replica has answered. Returns false, leaving the existing
+    // entry alone, if a task with the same id is still being tracked.
+    bool track(const std::string& task_id, tar::Priority priority, int replicas, bool await_quorum);
+
+    // Record a replica's answer; returns false if the task is not being tracked
+    bool recordAck(const std::string& task_id, bool success);
+
+    // Block until the quorum is reached, becomes unreachable, or the timeout expires.
+    // The entry is released afterwards; returns true if the quorum was reached,
+    // false if it was not or the task is not being tracked.
+    bool waitForQuorum(const std::string& task_id, std::chrono::milliseconds timeout);
+
+    struct LatencyStats {
+        uint64_t count = 0;
+        uint64_t total_us = 0;
+        uint64_t max_us = 0;
+    };
+
+    // Submit-to-quorum latency observed so far for one priority
+    LatencyStats quorumLatency(tar::Priority priority) const;
+
+private:
+    static constexpr size_t kNumShards = 16;
+
+    struct PendingTask {
+        std::chrono::steady_clock::time_point submitted;
+        uint8_t priority;
+        uint8_t replicas;
+        uint8_t required;
+        uint8_t acked = 0;
+        uint8_t failed = 0;
+        bool awaited; // A waiter owns removal of the entry
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::unordered_map<std::string, PendingTask> pending;
+    };
+
+    struct AtomicLatency {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> total_us{0};
+        std::atomic<uint64_t> max_us{0};
+    };
+
+    Shard& shardFor(const std::string& task_id);
+    void recordQuorumLatency(const PendingTask& entry);
+
+    std::array<Shard, kNumShards> shards_;
+    std::array<AtomicLatency, tar::Priority_ARRAYSIZE> latency_;
+};
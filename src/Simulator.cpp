@@ -0,0 +1,508 @@
+#include "Simulator.hpp"
+#include "EnvConfig.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+
+SimConfig::SimConfig()
+    : nodes(std::max(2, GetEnvOrDefault("SIM_NODES", 100))),
+      duration_s(GetEnvOrDefault("SIM_DURATION_S", 60)),
+      seed(GetEnvOrDefault("SIM_SEED", 1)),
+      tick_ms(std::max(1, GetEnvOrDefault("SIM_TICK_MS", 1000))),
+      heartbeat_fanout(GetEnvOrDefault("SIM_HEARTBEAT_FANOUT", 8)),
+      latency_us(GetEnvOrDefault("SIM_LATENCY_US", 500)),
+      jitter_us(GetEnvOrDefault("SIM_JITTER_US", 200)),
+      drop_percent(GetEnvOrDefault("SIM_DROP_PERCENT", 0)),
+      fail_percent(GetEnvOrDefault("SIM_FAIL_PERCENT", 0)),
+      fail_at_s(GetEnvOrDefault("SIM_FAIL_AT_S", 20)),
+      recover_at_s(GetEnvOrDefault("SIM_RECOVER_AT_S", 0)),
+      task_rate(GetEnvOrDefault("SIM_TASK_RATE", 500)),
+      skew_percent(GetEnvOrDefault("SIM_SKEW_PERCENT", 0)),
+      workers(std::max(1, GetEnvOrDefault("SIM_WORKERS", 1))),
+      service_ms(std::max(1, GetEnvOrDefault("SIM_SERVICE_MS", 50))),
+      deadline_ms(GetEnvOrDefault("SIM_DEADLINE_MS", 0)),
+      keys(GetEnvOrDefault("SIM_KEYS", 0)),
+      zones(std::max(0, GetEnvOrDefault("SIM_ZONES", 0))),
+      zone_latency_us(GetEnvOrDefault("SIM_ZONE_LATENCY_US", 5000)),
+      zone_infer(GetEnvOrDefault("SIM_ZONE_INFER", 0) != 0),
+      steal_check_ms(std::max(1, GetEnvOrDefault("STEAL_CHECK_INTERVAL_MS", 100))),
+      underloaded_threshold(GetEnvOrDefault("UNDERLOADED_THRESHOLD", 2)),
+      overloaded_threshold(GetEnvOrDefault("OVERLOADED_THRESHOLD", 10)),
+      max_steal_batch(GetEnvOrDefault("STEAL_MAX_BATCH", 1000)) {
+    if (heartbeat_fanout <= 0 || heartbeat_fanout > nodes - 1) heartbeat_fanout = nodes - 1;
+    zones = std::min(zones, nodes);
+}
+
+Simulator::Simulator(const SimConfig& config) : config_(config), rng_(config.seed) {
+    // Every peer hears from a given node once per full fanout cycle; tell the
+    // failure detector so it does not expect the raw tick. In hierarchical
+    // mode a node only cycles through its zone (plus, as leader, one peer per
+    // other zone).
+    int cycle_peers = config_.nodes - 1;
+    if (config_.zones > 0) {
+        setenv("HIERARCHICAL", "1", 0);
+        cycle_peers = std::min(cycle_peers, (config_.nodes + config_.zones - 1) / config_.zones - 1 + config_.zones - 1);
+    }
+    int ticks_per_cycle = std::max(1, (cycle_peers + config_.heartbeat_fanout - 1) / config_.heartbeat_fanout);
+    setenv("HEARTBEAT_INTERVAL_MS", std::to_string(config_.tick_ms * ticks_per_cycle).c_str(), 1);
+    // Detector history is per node pair, so keep it short when N is large
+    setenv("PHI_WINDOW_SIZE", "20", 0);
+    // Keys live in the payload so task ids keep their numbering
+    if (config_.keys > 0) {
+        setenv("AFFINITY_KEY", "payload", 0);
+        key_nodes_.resize(config_.keys);
+    }
+
+    nodes_.resize(config_.nodes);
+    for (int i = 0; i < config_.nodes; ++i) {
+        node_ids_.push_back("node_" + std::to_string(i));
+        index_of_[node_ids_.back()] = i;
+        zone_of_.push_back(config_.zones > 0 ? i * config_.zones / config_.nodes : 0);
+    }
+    for (int i = 0; i < config_.nodes; ++i) {
+        nodes_[i].id = node_ids_[i];
+        resetNode(i);
+    }
+}
+
+void Simulator::resetNode(int index) {
+    std::vector<std::string> peers;
+    peers.reserve(node_ids_.size() - 1);
+    for (int i = 0; i < config_.nodes; ++i) {
+        if (i != index) peers.push_back(node_ids_[i]);
+    }
+
+    Node& node = nodes_[index];
+    node.algorithm = std::make_unique<TARAlgorithm>(node.id, peers, clock_);
+    node.algorithm->setExecutorWorkers(config_.workers);
+    if (config_.zones > 0 && !config_.zone_infer) node.algorithm->setZone("zone_" + std::to_string(zone_of_[index]));
+    node.alive = true;
+    node.busy_workers = 0;
+    node.steal_deadline = std::chrono::nanoseconds(0);
+}
+
+void Simulator::schedule(std::chrono::nanoseconds delay, std::function<void()> action) {
+    events_.push(Event{clock_.elapsed() + delay, next_sequence_++, std::move(action)});
+}
+
+std::chrono::nanoseconds Simulator::networkDelay(int from, int to) {
+    int jitter = config_.jitter_us > 0 ? std::uniform_int_distribution<int>(0, config_.jitter_us)(rng_) : 0;
+    int zone_delay = zone_of_[from] != zone_of_[to] ? config_.zone_latency_us : 0;
+    return std::chrono::microseconds(config_.latency_us + zone_delay + jitter);
+}
+
+void Simulator::send(int from, int to, std::function<void()> deliver) {
+    if (!nodes_[from].alive) return;
+    ++messages_sent_;
+    if (zone_of_[from] != zone_of_[to]) ++cross_zone_messages_;
+    if (config_.drop_percent > 0 && std::uniform_int_distribution<int>(0, 99)(rng_) < config_.drop_percent) {
+        ++messages_dropped_;
+        return;
+    }
+    schedule(networkDelay(from, to), [this, to, deliver = std::move(deliver)] {
+        if (!nodes_[to].alive) {
+            ++messages_dropped_;
+            return;
+        }
+        deliver();
+    });
+}
+
+int Simulator::pickNode() {
+    if (config_.skew_percent > 0 && std::uniform_int_distribution<int>(0, 99)(rng_) < config_.skew_percent) {
+        return 0;
+    }
+    return std::uniform_int_distribution<int>(0, config_.nodes - 1)(rng_);
+}
+
+void Simulator::scheduleNextArrival() {
+    if (!workload_.empty()) {
+        if (next_arrival_ >= workload_.size()) return;
+        const SimArrival& arrival = workload_[next_arrival_++];
+        auto delay = std::max(std::chrono::nanoseconds(0), arrival.at - clock_.elapsed());
+        schedule(delay, [this, arrival] {
+            submitTask(arrival.node >= 0 ? arrival.node % config_.nodes : pickNode(), arrival.priority);
+            scheduleNextArrival();
+        });
+        return;
+    }
+
+    if (config_.task_rate <= 0) return;
+    double gap_s = std::exponential_distribution<double>(config_.task_rate)(rng_);
+    schedule(std::chrono::nanoseconds(static_cast<int64_t>(gap_s * 1e9)), [this] {
+        auto priority = static_cast<tar::Priority>(std::uniform_int_distribution<int>(0, tar::Priority_ARRAYSIZE - 1)(rng_));
+        submitTask(pickNode(), priority);
+        scheduleNextArrival();
+    });
+}
+
+void Simulator::submitTask(int node, tar::Priority priority) {
+    // A client retries the next server when its first choice is down
+    for (int attempt = 0; attempt < config_.nodes && !nodes_[node].alive; ++attempt) {
+        node = (node + 1) % config_.nodes;
+    }
+    if (!nodes_[node].alive) return;
+
+    uint64_t number = tasks_submitted_++;
+    submitted_at_.push_back(clock_.elapsed());
+    completed_.push_back(false);
+    task_key_.push_back(config_.keys > 0 ? std::uniform_int_distribution<int>(0, config_.keys - 1)(rng_) : -1);
+
+    auto task = std::make_shared<tar::Task>();
+    task->set_id("t" + std::to_string(number));
+    task->set_priority(priority);
+    if (task_key_.back() >= 0) task->set_payload("key_" + std::to_string(task_key_.back()));
+    task->set_timestamp(clock_.wallNanos());
+    if (config_.deadline_ms > 0) {
+        task->set_deadline(task->timestamp() + std::chrono::nanoseconds(std::chrono::milliseconds(config_.deadline_ms)).count());
+    }
+    task->set_coordinator_id(nodes_[node].id);
+
+    tar::ServerMetrics requester;
+    requester.set_server_id("sim_client");
+
+    // Admission control runs as in RouteTask; a rejected client does not retry
+    AdmissionDecision admission;
+    auto route_start = std::chrono::steady_clock::now();
+    auto targets = nodes_[node].algorithm->routeTask(task, requester, &admission);
+    route_wall_time_ += std::chrono::steady_clock::now() - route_start;
+    ++route_calls_;
+    if (admission.verdict == AdmissionDecision::kShed) {
+        ++tasks_shed_;
+        return;
+    }
+    if (admission.verdict == AdmissionDecision::kDeadlineMiss) {
+        ++deadline_rejections_;
+        return;
+    }
+
+    // Replicate to every routed target, as ReplicateTasks does
+    for (const auto& target : nodes_[node].algorithm->peerNames(targets)) {
+        int to = index_of_.at(target);
+        if (to == node) continue; // Affinity placed a copy here, and it is already held
+        send(node, to, [this, to, replica = *task]() mutable {
+            nodes_[to].algorithm->holdReplica(std::move(replica));
+            startWork(to);
+        });
+    }
+    startWork(node);
+}
+
+void Simulator::enqueue(int node, tar::Task task) {
+    nodes_[node].algorithm->addTaskToQueue(std::move(task));
+    startWork(node);
+}
+
+void Simulator::startWork(int index) {
+    Node& node = nodes_[index];
+    while (node.alive && node.busy_workers < config_.workers) {
+        auto task = node.algorithm->popTask();
+        if (!task) break;
+
+        ++node.busy_workers;
+        double service_ms = std::exponential_distribution<double>(1.0 / config_.service_ms)(rng_);
+        auto service_time = std::chrono::nanoseconds(static_cast<int64_t>(service_ms * 1e6));
+        schedule(service_time, [this, index, service_time, incarnation = node.incarnation, task = std::move(*task)] {
+            if (nodes_[index].incarnation != incarnation) return; // Lost in a crash
+            nodes_[index].algorithm->completeTask(task.id(), service_time);
+            finishTask(index, task);
+        });
+    }
+    node.algorithm->setLocalCpuUtilization(static_cast<float>(node.busy_workers) / config_.workers);
+}
+
+void Simulator::finishTask(int index, const tar::Task& task) {
+    Node& node = nodes_[index];
+    --node.busy_workers;
+
+    uint64_t number = std::stoull(task.id().substr(1));
+    if (task_key_[number] >= 0) {
+        ++keyed_executions_;
+        if (!key_nodes_[task_key_[number]].insert(index).second) ++warm_executions_;
+    }
+    if (completed_[number]) {
+        ++duplicate_executions_;
+    } else {
+        completed_[number] = true;
+        ++tasks_completed_;
+        uint64_t latency_us = std::chrono::duration_cast<std::chrono::microseconds>(clock_.elapsed() - submitted_at_[number]).count();
+        task_latency_.record(latency_us);
+        if (task.priority() == tar::Priority::URGENT) urgent_latency_.record(latency_us);
+        if (task.deadline() > 0 && clock_.wallNanos() > task.deadline()) ++deadline_misses_;
+    }
+
+    // Acknowledge to the coordinator and the other targets so they drop their standby copies
+    std::vector<int> holders;
+    auto add_holder = [&](const std::string& server) {
+        int holder = index_of_.at(server);
+        if (holder != index && std::find(holders.begin(), holders.end(), holder) == holders.end()) {
+            holders.push_back(holder);
+        }
+    };
+    add_holder(task.coordinator_id());
+    for (const auto& target : task.targets()) add_holder(target);
+    for (int holder : holders) {
+        send(index, holder, [this, holder, task_id = task.id(), server_id = node.id] {
+            tar::TaskAck ack;
+            ack.set_task_id(task_id);
+            ack.set_server_id(server_id);
+            ack.set_success(true);
+            nodes_[holder].algorithm->acknowledgeTask(ack);
+        });
+    }
+    startWork(index);
+}
+
+void Simulator::heartbeatTick() {
+    int fanout = config_.heartbeat_fanout;
+    std::vector<int> peers;
+    std::vector<int> probes;
+
+    for (int i = 0; i < config_.nodes; ++i) {
+        if (!nodes_[i].alive) continue;
+
+        // Peers this node heartbeats at all: everyone in flat mode, the zone
+        // and other zones' leaders in hierarchical mode. Peers not placed in
+        // a zone yet are all probed at once, as the server does every tick.
+        peers.clear();
+        probes.clear();
+        for (int m = 1; m < config_.nodes; ++m) {
+            int j = (i + m) % config_.nodes;
+            if (!nodes_[i].algorithm->shouldHeartbeat(node_ids_[j])) continue;
+            bool unplaced = nodes_[i].algorithm->isHierarchical() &&
+                            nodes_[i].algorithm->getPeerZone(node_ids_[j]) == PeerZone::kUnplaced;
+            (unplaced ? probes : peers).push_back(j);
+        }
+
+        // Rotate through the peers so each pair exchanges metrics at a steady cadence
+        int count = std::min<int>(fanout, peers.size());
+        for (int k = 0; k < count; ++k) probes.push_back(peers[(tick_ * fanout + k) % peers.size()]);
+        for (int j : probes) {
+            tar::ServerMetrics metrics = nodes_[i].algorithm->getLocalMetrics();
+            auto sent_at = clock_.elapsed();
+
+            send(i, j, [this, i, j, metrics, sent_at] {
+                nodes_[j].algorithm->updateServerMetrics(metrics, TARAlgorithm::MetricsSource::kHeartbeatRequest);
+                tar::ServerMetrics reply = nodes_[j].algorithm->getLocalMetrics();
+                send(j, i, [this, i, reply, sent_at]() mutable {
+                    reply.set_network_latency(std::chrono::duration<float, std::milli>(clock_.elapsed() - sent_at).count());
+                    nodes_[i].algorithm->updateServerMetrics(reply, TARAlgorithm::MetricsSource::kHeartbeatReply);
+                });
+            });
+        }
+    }
+
+    for (int i = 0; i < config_.nodes; ++i) {
+        if (nodes_[i].alive && nodes_[i].algorithm->promoteStandbyTasks() > 0) startWork(i);
+    }
+
+    ++tick_;
+    checkLeaders();
+    sampleLoad();
+    schedule(std::chrono::milliseconds(config_.tick_ms), [this] { heartbeatTick(); });
+}
+
+void Simulator::checkLeaders() {
+    for (auto& node : nodes_) {
+        if (!node.alive) continue;
+        if (node.algorithm->needsElection()) {
+            node.algorithm->electLeader();
+            ++elections_;
+        }
+    }
+
+    if (leaders_converged_) return;
+
+    // Every zone (the whole cluster in flat mode) agrees on a live leader of its own
+    std::vector<std::string> agreed(std::max(1, config_.zones));
+    for (int i = 0; i < config_.nodes; ++i) {
+        if (!nodes_[i].alive) continue;
+        std::string leader = nodes_[i].algorithm->getCurrentLeader();
+        std::string& zone_leader = agreed[zone_of_[i]];
+        if (leader.empty() || (!zone_leader.empty() && leader != zone_leader)) return;
+        zone_leader = leader;
+    }
+    for (size_t zone = 0; zone < agreed.size(); ++zone) {
+        if (agreed[zone].empty()) continue; // Every member is down
+        int leader = index_of_.at(agreed[zone]);
+        if (!nodes_[leader].alive || zone_of_[leader] != static_cast<int>(zone)) return;
+    }
+
+    leaders_converged_ = true;
+    convergence_times_.push_back(clock_.elapsed() - disturbed_at_);
+}
+
+void Simulator::sampleLoad() {
+    std::vector<double> lengths;
+    for (const auto& node : nodes_) {
+        if (node.alive) lengths.push_back(node.algorithm->getTaskQueueLength());
+    }
+    if (lengths.empty()) return;
+
+    double mean = std::accumulate(lengths.begin(), lengths.end(), 0.0) / lengths.size();
+    if (mean <= 0) return;
+    double variance = 0.0;
+    for (double length : lengths) variance += (length - mean) * (length - mean);
+    variance /= lengths.size();
+
+    imbalance_cov_sum_ += std::sqrt(variance) / mean;
+    imbalance_max_sum_ += *std::max_element(lengths.begin(), lengths.end()) / mean;
+    ++imbalance_samples_;
+}
+
+void Simulator::stealCheck(int index) {
+    schedule(std::chrono::milliseconds(config_.steal_check_ms), [this, index] { stealCheck(index); });
+
+    Node& node = nodes_[index];
+    if (!node.alive || clock_.elapsed() < node.steal_deadline) return;
+    int local_length = node.algorithm->getTaskQueueLength();
+    if (local_length >= config_.underloaded_threshold) return;
+
+    // Same victim choice as TaskStealer, but one request per round
+    for (const auto& peer : node.algorithm->getOverloadedPeers(config_.overloaded_threshold)) {
+        int max_tasks = std::min(config_.max_steal_batch, (peer.queue_length() - local_length) / 2);
+        if (max_tasks <= 0) continue;
+
+        int victim = index_of_.at(peer.server_id());
+        tar::ServerMetrics thief = node.algorithm->getLocalMetrics();
+        node.steal_deadline = clock_.elapsed() + std::chrono::milliseconds(GetEnvOrDefault("HEARTBEAT_DEADLINE_MS", 1000));
+        ++steal_requests_;
+
+        send(index, victim, [this, index, victim, thief, max_tasks] {
+            auto tasks = nodes_[victim].algorithm->stealTasks(thief, max_tasks);
+            send(victim, index, [this, index, tasks = std::move(tasks)]() mutable {
+                nodes_[index].steal_deadline = std::chrono::nanoseconds(0);
+                if (tasks.empty()) ++empty_steals_;
+                tasks_stolen_ += tasks.size();
+                for (auto& task : tasks) {
+                    enqueue(index, std::move(task));
+                }
+            });
+        });
+        return;
+    }
+}
+
+void Simulator::crashNodes() {
+    std::vector<int> order(config_.nodes);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), rng_);
+
+    int count = config_.nodes * config_.fail_percent / 100;
+    for (int i = 0; i < count; ++i) {
+        Node& node = nodes_[order[i]];
+        node.alive = false;
+        ++node.incarnation;
+    }
+    disturbed_at_ = clock_.elapsed();
+    leaders_converged_ = false;
+}
+
+void Simulator::recoverNodes() {
+    for (int i = 0; i < config_.nodes; ++i) {
+        if (!nodes_[i].alive) resetNode(i); // Restarts with an empty queue and no peer metrics
+    }
+    disturbed_at_ = clock_.elapsed();
+    leaders_converged_ = false;
+}
+
+void Simulator::run() {
+    auto wall_start = std::chrono::steady_clock::now();
+    auto end = std::chrono::nanoseconds(std::chrono::seconds(config_.duration_s));
+
+    schedule(std::chrono::nanoseconds(0), [this] { heartbeatTick(); });
+    for (int i = 0; i < config_.nodes; ++i) {
+        // Stagger the steal checks like independently started servers
+        auto offset = std::uniform_int_distribution<int>(0, config_.steal_check_ms * 1000 - 1)(rng_);
+        schedule(std::chrono::microseconds(offset), [this, i] { stealCheck(i); });
+    }
+    if (config_.fail_percent > 0) {
+        schedule(std::chrono::seconds(config_.fail_at_s), [this] { crashNodes(); });
+        if (config_.recover_at_s > config_.fail_at_s) {
+            schedule(std::chrono::seconds(config_.recover_at_s), [this] { recoverNodes(); });
+        }
+    }
+    scheduleNextArrival();
+
+    while (!events_.empty() && events_.top().at <= end) {
+        // Only the action is moved out; the ordering fields stay intact for pop()
+        auto action = std::move(const_cast<Event&>(events_.top()).action);
+        clock_.advanceTo(events_.top().at);
+        events_.pop();
+        action();
+    }
+    clock_.advanceTo(end);
+
+    wall_time_ = std::chrono::steady_clock::now() - wall_start;
+}
+
+void Simulator::report() const {
+    double wall_s = std::chrono::duration<double>(wall_time_).count();
+    std::printf("nodes=%d duration=%ds tick=%dms fanout=%d latency=%d+%dus drop=%d%% fail=%d%%@%ds task_rate=%d/s skew=%d%% seed=%d\n",
+                config_.nodes, config_.duration_s, config_.tick_ms, config_.heartbeat_fanout, config_.latency_us,
+                config_.jitter_us, config_.drop_percent, config_.fail_percent, config_.fail_at_s, config_.task_rate,
+                config_.skew_percent, config_.seed);
+    std::printf("simulated %ds in %.2fs wall (%.1fx)\n", config_.duration_s, wall_s, config_.duration_s / std::max(wall_s, 1e-9));
+
+    uint64_t queued = 0;
+    uint64_t standby = 0;
+    for (const auto& node : nodes_) {
+        if (!node.alive) continue;
+        queued += node.algorithm->getTaskQueueLength();
+        standby += node.algorithm->getStandbyCount();
+    }
+    std::printf("tasks: %llu submitted, %llu completed, %llu duplicate executions, %llu still queued (%llu standby copies)\n",
+                static_cast<unsigned long long>(tasks_submitted_), static_cast<unsigned long long>(tasks_completed_),
+                static_cast<unsigned long long>(duplicate_executions_), static_cast<unsigned long long>(queued),
+                static_cast<unsigned long long>(standby));
+    std::printf("admission: %llu shed, %llu rejected for their deadline; %llu completed after the deadline (goodput %.1f tasks/s)\n",
+                static_cast<unsigned long long>(tasks_shed_), static_cast<unsigned long long>(deadline_rejections_),
+                static_cast<unsigned long long>(deadline_misses_),
+                (tasks_completed_ - deadline_misses_) / static_cast<double>(std::max(1, config_.duration_s)));
+
+    auto print_latency = [](const char* name, const LatencyHistogram& histogram) {
+        auto latency = histogram.snapshot();
+        std::printf("%s latency (virtual ms): p50 %.1f  p99 %.1f  p999 %.1f  max %.1f\n", name,
+                    latency.percentile(0.5) / 1000.0, latency.percentile(0.99) / 1000.0,
+                    latency.percentile(0.999) / 1000.0, latency.max_us / 1000.0);
+    };
+    print_latency("task", task_latency_);
+    print_latency("URGENT", urgent_latency_);
+
+    if (imbalance_samples_ > 0) {
+        std::printf("load balance: queue length CoV %.3f, max/mean %.2f (averaged over %llu ticks)\n",
+                    imbalance_cov_sum_ / imbalance_samples_, imbalance_max_sum_ / imbalance_samples_,
+                    static_cast<unsigned long long>(imbalance_samples_));
+    }
+    if (keyed_executions_ > 0) {
+        double nodes_per_key = 0.0;
+        for (const auto& nodes : key_nodes_) nodes_per_key += nodes.size();
+        std::printf("key locality: %.1f%% of keyed executions on a node that had run the key before, %.1f nodes per key\n",
+                    100.0 * warm_executions_ / keyed_executions_, nodes_per_key / key_nodes_.size());
+    }
+    std::printf("stealing: %llu requests, %llu empty, %llu tasks moved\n",
+                static_cast<unsigned long long>(steal_requests_), static_cast<unsigned long long>(empty_steals_),
+                static_cast<unsigned long long>(tasks_stolen_));
+
+    std::printf("elections: %llu; leader convergence:", static_cast<unsigned long long>(elections_));
+    for (auto time : convergence_times_) {
+        std::printf(" %.1fs", std::chrono::duration<double>(time).count());
+    }
+    std::printf("%s\n", leaders_converged_ ? "" : " (not converged at end)");
+
+    std::printf("messages: %llu sent, %llu dropped\n",
+                static_cast<unsigned long long>(messages_sent_), static_cast<unsigned long long>(messages_dropped_));
+    if (config_.zones > 0) {
+        std::printf("zones: %d (%s), +%dus between zones; %llu cross-zone messages (%.1f per tick)\n",
+                    config_.zones, config_.zone_infer ? "inferred from latency" : "configured", config_.zone_latency_us,
+                    static_cast<unsigned long long>(cross_zone_messages_),
+                    cross_zone_messages_ / static_cast<double>(std::max<uint64_t>(1, tick_)));
+    }
+    if (route_calls_ > 0) {
+        double route_s = std::chrono::duration<double>(route_wall_time_).count();
+        std::printf("routing: %llu routeTask calls, %.0f ns each, %.0f calls/s\n",
+                    static_cast<unsigned long long>(route_calls_), route_s * 1e9 / route_calls_, route_calls_ / std::max(route_s, 1e-9));
+    }
+}
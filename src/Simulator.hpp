@@ -0,0 +1,182 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "tar.pb.h"
+#include "Clock.hpp"
+#include "Stats.hpp"
+#include "TARAlgorithm.hpp"
+
+// Virtual time shared by every simulated node; it only moves when the
+// simulator jumps to the next event
+class VirtualClock : public ClockSource {
+public:
+    std::chrono::steady_clock::time_point now() const override {
+        return std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(elapsed_));
+    }
+    int64_t wallNanos() const override { return elapsed_.count(); }
+
+    std::chrono::nanoseconds elapsed() const { return elapsed_; }
+    void advanceTo(std::chrono::nanoseconds elapsed) { elapsed_ = elapsed; }
+
+private:
+    std::chrono::nanoseconds elapsed_{0};
+};
+
+// Simulation settings, read from SIM_* environment variables. The stealing
+// thresholds reuse the server's own variable names.
+struct SimConfig {
+    SimConfig();
+
+    int nodes;
+    int duration_s;         // Virtual seconds to simulate
+    int seed;
+    int tick_ms;            // Heartbeat and leader check period
+    int heartbeat_fanout;   // Peers each node heartbeats per tick; 0 = all
+    int latency_us;         // One-way network delay ...
+    int jitter_us;          // ... plus up to this much uniform jitter
+    int drop_percent;       // Messages lost in transit
+    int fail_percent;       // Nodes that crash at fail_at_s
+    int fail_at_s;
+    int recover_at_s;       // Crashed nodes restart empty; 0 = never
+    int task_rate;          // Cluster-wide arrivals per virtual second (Poisson)
+    int skew_percent;       // Share of arrivals sent to node 0
+    int workers;            // Executor slots per node
+    int service_ms;         // Mean task execution time (exponential)
+    int deadline_ms;        // Deadline given to every generated task; 0 = none
+    int keys;               // Distinct data keys tasks are spread over (payload "key_<n>"); 0 = none
+    int zones;              // Hierarchical mode over this many equal zones of consecutive nodes; 0 = flat
+    int zone_latency_us;    // Extra one-way delay between zones
+    bool zone_infer;        // Leave zones to latency inference instead of naming them
+    int steal_check_ms;
+    int underloaded_threshold;
+    int overloaded_threshold;
+    int max_steal_batch;
+};
+
+// One recorded task arrival: when, how urgent, and which node received it
+struct SimArrival {
+    std::chrono::nanoseconds at;
+    tar::Priority priority;
+    int node;
+};
+
+// Runs many TARAlgorithm instances in one process on a virtual clock. The
+// gRPC transport is replaced by an in-memory event queue with configurable
+// latency, loss and node failures; the message flow mirrors the server
+// (heartbeats, replication, acks, batch stealing, leader checks). Runs are
+// deterministic for a given configuration and seed.
+class Simulator {
+public:
+    explicit Simulator(const SimConfig& config);
+
+    // Replay a recorded workload instead of generating Poisson arrivals
+    void setWorkload(std::vector<SimArrival> arrivals) { workload_ = std::move(arrivals); }
+
+    void run();
+    void report() const;
+
+private:
+    struct Node {
+        std::string id;
+        std::unique_ptr<TARAlgorithm> algorithm;
+        bool alive = true;
+        uint64_t incarnation = 0; // Bumped on crash so in-flight work from before is discarded
+        int busy_workers = 0;
+        std::chrono::nanoseconds steal_deadline{0}; // A steal is in flight until then
+    };
+
+    struct Event {
+        std::chrono::nanoseconds at;
+        uint64_t sequence; // Ties run in scheduling order
+        std::function<void()> action;
+
+        bool operator>(const Event& other) const {
+            return at != other.at ? at > other.at : sequence > other.sequence;
+        }
+    };
+
+    void schedule(std::chrono::nanoseconds delay, std::function<void()> action);
+    // Deliver a message after a network delay, unless it is lost or either end is down
+    void send(int from, int to, std::function<void()> deliver);
+    std::chrono::nanoseconds networkDelay(int from, int to);
+
+    void resetNode(int index);
+    void submitTask(int node, tar::Priority priority);
+    void enqueue(int node, tar::Task task);
+    void startWork(int node);
+    void finishTask(int node, const tar::Task& task);
+    int pickNode();
+
+    void heartbeatTick();
+    void stealCheck(int node);
+    void sampleLoad();
+    void checkLeaders();
+    void crashNodes();
+    void recoverNodes();
+    void scheduleNextArrival();
+
+    SimConfig config_;
+    VirtualClock clock_;
+    std::mt19937_64 rng_;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_;
+    uint64_t next_sequence_ = 0;
+
+    std::vector<Node> nodes_;
+    std::unordered_map<std::string, int> index_of_;
+    std::vector<std::string> node_ids_;
+    std::vector<int> zone_of_; // All 0 in flat mode
+    std::vector<SimArrival> workload_;
+    size_t next_arrival_ = 0;
+    uint64_t tick_ = 0;
+
+    // Per-task bookkeeping, indexed by the numeric part of the task id
+    std::vector<std::chrono::nanoseconds> submitted_at_;
+    std::vector<bool> completed_;
+    std::vector<int> task_key_; // -1 without keys
+
+    // Cache locality of routed replicas (the coordinator's own copy runs
+    // wherever the client sent the task): the nodes that have run each key so far
+    std::vector<std::unordered_set<int>> key_nodes_;
+    uint64_t keyed_executions_ = 0;
+    uint64_t warm_executions_ = 0; // On a node that had already run the same key
+
+    // Results
+    LatencyHistogram task_latency_; // Virtual microseconds from arrival to first completion
+    LatencyHistogram urgent_latency_;
+    uint64_t tasks_submitted_ = 0;
+    uint64_t tasks_completed_ = 0;
+    uint64_t tasks_shed_ = 0;          // Turned away by admission control under overload ...
+    uint64_t deadline_rejections_ = 0; // ... or because their deadline could not be met
+    uint64_t deadline_misses_ = 0;     // Admitted, but first completed after the deadline
+    uint64_t duplicate_executions_ = 0; // Replicas that ran after the task had already completed
+    uint64_t messages_sent_ = 0;
+    uint64_t cross_zone_messages_ = 0;
+    uint64_t messages_dropped_ = 0;
+    uint64_t steal_requests_ = 0;
+    uint64_t empty_steals_ = 0;
+    uint64_t tasks_stolen_ = 0;
+    uint64_t elections_ = 0;
+    uint64_t route_calls_ = 0;
+    std::chrono::nanoseconds route_wall_time_{0};
+    std::chrono::nanoseconds wall_time_{0};
+
+    // Load balance: coefficient of variation and max/mean of live queue lengths, averaged over ticks
+    double imbalance_cov_sum_ = 0.0;
+    double imbalance_max_sum_ = 0.0;
+    uint64_t imbalance_samples_ = 0;
+
+    // Leader convergence: time from start (or the last crash/recovery) until every live node agrees on a live leader
+    // (of its own zone in hierarchical mode)
+    std::chrono::nanoseconds disturbed_at_{0};
+    bool leaders_converged_ = false;
+    std::vector<std::chrono::nanoseconds> convergence_times_;
+};
@@ -0,0 +1,131 @@
+#include "Stats.hpp"
+#include <algorithm>
+#include <sstream>
+
+size_t LatencyHistogram::bucketFor(uint64_t micros) {
+    constexpr uint64_t kSubBuckets = 1u << kSubBucketBits;
+    if (micros < kSubBuckets) return micros;
+
+    int exponent = 63 - __builtin_clzll(micros);
+    size_t bucket = (exponent - kSubBucketBits + 1) * kSubBuckets + ((micros >> (exponent - kSubBucketBits)) & (kSubBuckets - 1));
+    return std::min(bucket, kNumBuckets - 1);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t bucket) {
+    constexpr uint64_t kSubBuckets = 1u << kSubBucketBits;
+    if (bucket < kSubBuckets) return bucket;
+
+    int shift = bucket / kSubBuckets - 1;
+    uint64_t lower = (kSubBuckets + bucket % kSubBuckets) << shift;
+    return lower + (uint64_t{1} << shift) - 1;
+}
+
+size_t LatencyHistogram::stripeForThisThread() {
+    static std::atomic<size_t> next_stripe{0};
+    thread_local size_t stripe = next_stripe.fetch_add(1, std::memory_order_relaxed) % kNumStripes;
+    return stripe;
+}
+
+void LatencyHistogram::record(uint64_t micros) {
+    Stripe& stripe = stripes_[stripeForThisThread()];
+    stripe.buckets[bucketFor(micros)].fetch_add(1, std::memory_order_relaxed);
+    stripe.count.fetch_add(1, std::memory_order_relaxed);
+    stripe.sum_us.fetch_add(micros, std::memory_order_relaxed);
+
+    uint64_t max = stripe.max_us.load(std::memory_order_relaxed);
+    while (micros > max && !stripe.max_us.compare_exchange_weak(max, micros, std::memory_order_relaxed)) {}
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot snapshot;
+    for (const auto& stripe : stripes_) {
+        for (size_t i = 0; i < kNumBuckets; ++i) {
+            snapshot.buckets[i] += stripe.buckets[i].load(std::memory_order_relaxed);
+        }
+        snapshot.count += stripe.count.load(std::memory_order_relaxed);
+        snapshot.sum_us += stripe.sum_us.load(std::memory_order_relaxed);
+        snapshot.max_us = std::max(snapshot.max_us, stripe.max_us.load(std::memory_order_relaxed));
+    }
+    return snapshot;
+}
+
+uint64_t LatencyHistogram::Snapshot::percentile(double p) const {
+    if (count == 0) return 0;
+
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p * count + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kNumBuckets; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) return std::min(bucketUpperBound(i), max_us);
+    }
+    return max_us;
+}
+
+namespace {
+
+void RenderSummary(std::ostringstream& out, const char* name, const char* label, const LatencyHistogram& histogram) {
+    auto snapshot = histogram.snapshot();
+    for (double quantile : {0.5, 0.9, 0.99, 0.999}) {
+        out << name << "{" << label << ",quantile=\"" << quantile << "\"} " << snapshot.percentile(quantile) << "\n";
+    }
+    out << name << "{" << label << ",quantile=\"1\"} " << snapshot.max_us << "\n";
+    out << name << "_sum{" << label << "} " << snapshot.sum_us << "\n";
+    out << name << "_count{" << label << "} " << snapshot.count << "\n";
+}
+
+} // namespace
+
+std::string ServerStats::renderPrometheus(const std::array<size_t, tar::Priority_ARRAYSIZE>& queue_depth_by_priority) const {
+    std::ostringstream out;
+
+    out << "# TYPE tar_rpc_latency_us summary\n";
+    RenderSummary(out, "tar_rpc_latency_us", "rpc=\"RouteTask\"", route_task);
+    RenderSummary(out, "tar_rpc_latency_us", "rpc=\"Heartbeat\"", heartbeat);
+    RenderSummary(out, "tar_rpc_latency_us", "rpc=\"RequestTaskTransfer\"", request_task_transfer);
+    RenderSummary(out, "tar_rpc_latency_us", "rpc=\"AcknowledgeTask\"", acknowledge_task);
+
+    out << "# TYPE tar_lock_wait_us summary\n";
+    RenderSummary(out, "tar_lock_wait_us", "lock=\"peer_metrics\"", metrics_lock_wait);
+    RenderSummary(out, "tar_lock_wait_us", "lock=\"task_queue\"", queue_lock_wait);
+
+    out << "# TYPE tar_tasks_stolen_total counter\n"
+        << "tar_tasks_stolen_total " << tasks_stolen.load(std::memory_order_relaxed) << "\n";
+    out << "# TYPE tar_tasks_transferred_total counter\n"
+        << "tar_tasks_transferred_total " << tasks_transferred.load(std::memory_order_relaxed) << "\n";
+    out << "# TYPE tar_hop_rejections_total counter\n"
+        << "tar_hop_rejections_total " << hop_rejections.load(std::memory_order_relaxed) << "\n";
+    out << "# TYPE tar_standby_promotions_total counter\n"
+        << "tar_standby_promotions_total " << standby_promotions.load(std::memory_order_relaxed) << "\n";
+    out << "# TYPE tar_leader_elections_total counter\n"
+        << "tar_leader_elections_total " << elections.load(std::memory_order_relaxed) << "\n";
+
+    out << "# TYPE tar_affinity_routes_total counter\n"
+        << "tar_affinity_routes_total{placement=\"preferred\"} " << affinity_preferred.load(std::memory_order_relaxed) << "\n"
+        << "tar_affinity_routes_total{placement=\"spilled\"} " << affinity_spilled.load(std::memory_order_relaxed) << "\n";
+    out << "# TYPE tar_heartbeats_sent_total counter\n"
+        << "tar_heartbeats_sent_total{scope=\"zone\"} " << zone_heartbeats.load(std::memory_order_relaxed) << "\n"
+        << "tar_heartbeats_sent_total{scope=\"cross_zone\"} " << cross_zone_heartbeats.load(std::memory_order_relaxed) << "\n";
+    out << "# TYPE tar_tasks_shed_total counter\n";
+    for (int priority = 0; priority < tar::Priority_ARRAYSIZE; ++priority) {
+        out << "tar_tasks_shed_total{priority=\"" << tar::Priority_Name(static_cast<tar::Priority>(priority)) << "\"} "
+            << tasks_shed[priority].load(std::memory_order_relaxed) << "\n";
+    }
+    out << "# TYPE tar_deadline_rejections_total counter\n";
+    for (int priority = 0; priority < tar::Priority_ARRAYSIZE; ++priority) {
+        out << "tar_deadline_rejections_total{priority=\"" << tar::Priority_Name(static_cast<tar::Priority>(priority)) << "\"} "
+            << deadline_rejections[priority].load(std::memory_order_relaxed) << "\n";
+    }
+
+    out << "# TYPE tar_queue_depth gauge\n";
+    for (int priority = 0; priority < tar::Priority_ARRAYSIZE; ++priority) {
+        out << "tar_queue_depth{priority=\"" << tar::Priority_Name(static_cast<tar::Priority>(priority)) << "\"} "
+            << queue_depth_by_priority[priority] << "\n";
+    }
+
+    return out.str();
+}
+
+ServerStats& GetServerStats() {
+    static ServerStats stats;
+    return stats;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include "tar.pb.h"
+
+// Log-linear latency histogram in microseconds (8 sub-buckets per power of
+// two, so any quantile is within 12.5%). Writers update a stripe owned by
+// their thread with relaxed atomics, so recording never takes a lock and
+// rarely shares a cache line; readers merge the stripes.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 3;
+    static constexpr size_t kNumBuckets = 312; // Covers up to 2^40 us
+    static constexpr size_t kNumStripes = 8;
+
+    void record(uint64_t micros);
+
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t sum_us = 0;
+        uint64_t max_us = 0;
+        std::array<uint64_t, kNumBuckets> buckets{};
+
+        // Upper bound of the bucket holding the p-th percentile (p in [0, 1])
+        uint64_t percentile(double p) const;
+    };
+    Snapshot snapshot() const;
+
+private:
+    static size_t bucketFor(uint64_t micros);
+    static uint64_t bucketUpperBound(size_t bucket);
+    static size_t stripeForThisThread();
+
+    struct alignas(64) Stripe {
+        std::array<std::atomic<uint64_t>, kNumBuckets> buckets{};
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum_us{0};
+        std::atomic<uint64_t> max_us{0};
+    };
+    std::array<Stripe, kNumStripes> stripes_;
+};
+
+// Records the lifetime of a scope into a histogram
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyHistogram& histogram)
+        : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedLatency() {
+        histogram_.record(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start_).count());
+    }
+
+private:
+    LatencyHistogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// lock_guard that records how long it waited, but only when the lock was
+// contended; the uncontended path is a plain try_lock
+class TimedLockGuard {
+public:
+    TimedLockGuard(std::mutex& mutex, LatencyHistogram& wait_histogram) : mutex_(mutex) {
+        if (mutex_.try_lock()) return;
+        ScopedLatency wait(wait_histogram);
+        mutex_.lock();
+    }
+    ~TimedLockGuard() { mutex_.unlock(); }
+
+    TimedLockGuard(const TimedLockGuard&) = delete;
+    TimedLockGuard& operator=(const TimedLockGuard&) = delete;
+
+private:
+    std::mutex& mutex_;
+};
+
+// Process-wide instrumentation for the server, exported through GetStats
+struct ServerStats {
+    LatencyHistogram route_task;
+    LatencyHistogram heartbeat;
+    LatencyHistogram request_task_transfer;
+    LatencyHistogram acknowledge_task;
+    LatencyHistogram metrics_lock_wait; // TARAlgorithm peer metrics writers
+    LatencyHistogram queue_lock_wait;   // TaskQueue shard locks
+
+    std::atomic<uint64_t> tasks_stolen{0};      // Pulled from peers
+    std::atomic<uint64_t> tasks_transferred{0}; // Given to peers
+    std::atomic<uint64_t> hop_rejections{0};
+    std::atomic<uint64_t> standby_promotions{0}; // Standby copies run here after their executor failed
+    std::atomic<uint64_t> elections{0};
+    std::atomic<uint64_t> affinity_preferred{0}; // Affinity routes placed entirely on the key's ring members
+    std::atomic<uint64_t> affinity_spilled{0};   // ... and those where a member over its load bound was replaced
+    std::atomic<uint64_t> zone_heartbeats{0};       // Heartbeats sent within this server's zone (or to unplaced peers) ...
+    std::atomic<uint64_t> cross_zone_heartbeats{0}; // ... and to other zones, by zone leaders only
+
+    // Admission control rejections, by task priority
+    std::array<std::atomic<uint64_t>, tar::Priority_ARRAYSIZE> tasks_shed{};
+    std::array<std::atomic<uint64_t>, tar::Priority_ARRAYSIZE> deadline_rejections{};
+
+    // Prometheus text exposition; queue depths are passed in by the caller
+    std::string renderPrometheus(const std::array<size_t, tar::Priority_ARRAYSIZE>& queue_depth_by_priority) const;
+};
+
+ServerStats& GetServerStats();
@@ -1,131 +1,783 @@
 #include "TARAlgorithm.hpp"
+#include "EnvConfig.hpp"
+#include "Stats.hpp"
+#include "Logger.hpp"
 #include <algorithm>
-#include <iostream>
 #include <chrono>
+#include <limits>
 
-TARAlgorithm::TARAlgorithm(const std::string& self_id, const std::vector<std::string>& peers)
-    : self_id_(self_id), peers_(peers) {
-    std::cout << "TARAlgorithm created with server_id: " << self_id_ << std::endl;
-    std::cout << "Initial peers: ";
-    for (const auto& peer : peers_) std::cout << peer << " ";
-    std::cout << std::endl;
+TARAlgorithm::TARAlgorithm(const std::string& self_id, const std::vector<std::string>& peers,
+                           const ClockSource& clock)
+    : self_id_(self_id), peers_(peers), clock_(clock),
+      failure_detector_(GetEnvOrDefault("PHI_THRESHOLD", 8),
+                        std::chrono::milliseconds(GetEnvOrDefault("HEARTBEAT_INTERVAL_MS", 5000)),
+                        std::chrono::milliseconds(GetEnvOrDefault("PHI_MIN_STDDEV_MS", 100)),
+                        std::chrono::milliseconds(GetEnvOrDefault("PHI_ACCEPTABLE_PAUSE_MS", 200)),
+                        GetEnvOrDefault("PHI_WINDOW_SIZE", 100)),
+      affinity_routing_(GetEnvOrDefault("AFFINITY_ROUTING", 0) != 0),
+      affinity_key_from_payload_(GetEnvOrDefault("AFFINITY_KEY", "id") == "payload"),
+      affinity_key_delimiter_(GetEnvOrDefault("AFFINITY_KEY_DELIMITER", ":")),
+      affinity_load_bound_(GetEnvOrDefault("AFFINITY_LOAD_BOUND_PERCENT", 125) / 100.0f),
+      affinity_min_bound_(static_cast<float>(GetEnvOrDefault("OVERLOADED_THRESHOLD", 10))),
+      hierarchical_(GetEnvOrDefault("HIERARCHICAL", 0) != 0),
+      zone_(GetEnvOrDefault("ZONE", "")),
+      zone_latency_ms_(static_cast<float>(GetEnvOrDefault("ZONE_LATENCY_MS", 2))),
+      zone_load_ttl_nanos_(3 * static_cast<int64_t>(GetEnvOrDefault("HEARTBEAT_INTERVAL_MS", 5000)) * 1000000),
+      standby_grace_(std::chrono::milliseconds(GetEnvOrDefault("STANDBY_GRACE_MS",
+                                                               3 * GetEnvOrDefault("HEARTBEAT_INTERVAL_MS", 5000)))),
+      admission_(GetEnvOrDefault("ADMISSION_CONTROL", 1) != 0,
+                 {GetEnvOrDefault("ADMIT_LOW_QUEUE_LIMIT", 200),
+                  GetEnvOrDefault("ADMIT_MODERATE_QUEUE_LIMIT", 1000),
+                  GetEnvOrDefault("ADMIT_URGENT_QUEUE_LIMIT", 0)}) {
+    LOG_INFO("TAR", "TARAlgorithm created with server_id: ", self_id_, ", initial peers: ", LogList(peers_));
+
+    // Startup peers take the first ids, in order; none has been heard from yet
+    auto directory = std::make_shared<PeerDirectory>();
+    for (const auto& peer : peers_) directory->intern(peer);
+    auto table = std::make_shared<PeerTable>();
+    table->resize(directory->names.size());
+    table->directory = directory;
+    peer_metrics_ = std::move(table);
+
+    if (affinity_routing_) {
+        // Every server puts itself and its peers on the ring, so they all see
+        // the same members and agree on placement. Member 0 is this server,
+        // the rest are added in id order: member i + 1 is PeerId i.
+        auto ring = std::make_shared<HashRing>(GetEnvOrDefault("AFFINITY_VNODES", 100));
+        ring->add(self_id_);
+        for (const auto& name : directory->names) ring->add(name);
+        affinity_ring_ = std::move(ring);
+    }
+
+    // Persist the queue when a log directory is configured, and pick up
+    // whatever a previous run of this server left queued
+    std::string log_dir = GetEnvOrDefault("TASK_LOG_DIR", "");
+    if (!log_dir.empty()) {
+        TaskLog::Options options;
+        options.sync_window = std::chrono::milliseconds(GetEnvOrDefault("TASK_LOG_SYNC_MS", 2));
+        options.initial_size = static_cast<size_t>(GetEnvOrDefault("TASK_LOG_INITIAL_MB", 64)) << 20;
+        options.compact_min_size = static_cast<size_t>(GetEnvOrDefault("TASK_LOG_COMPACT_MIN_MB", 64)) << 20;
+
+        std::string file_name = "tasks-" + self_id_ + ".log";
+        std::replace_if(file_name.begin(), file_name.end(), [](char c) { return c == '/' || c == ':'; }, '_');
+        std::string path = log_dir + "/" + file_name;
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<tar::Task> recovered;
+        task_log_ = TaskLog::open(path, options, &recovered);
+        for (auto& task : recovered) {
+            placeTask(std::make_shared<tar::Task>(std::move(task))); // Already in the log
+        }
+        if (task_log_) {
+            LOG_INFO("Task Log", "Recovered ", recovered.size(), " queued tasks from ", path, " in ",
+                     std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count(), " ms");
+        } else {
+            LOG_ERROR("Task Log", "Running without a durable queue");
+        }
+    }
 }
 
-std::vector<std::string> TARAlgorithm::routeTask(const tar::Task& task, const tar::ServerMetrics& requester) {
-    std::lock_guard<std::mutex> lock(mutex_);
+float TARAlgorithm::scoreServer(int queue_length, float cpu_utilization, int64_t heartbeat_age, float network_latency) {
+    return 1.5f / (queue_length + 1)
+         + 2.0f / (cpu_utilization + 1)
+         + 1.0f / (heartbeat_age + 1)
+         - network_latency; // Lower latency is better
+}
 
-    std::vector<std::pair<std::string, float>> scored_peers;
+TargetList TARAlgorithm::selectTopK(const PeerTable& peers, size_t k, PhiAccrualDetector::Clock::time_point now,
+                                    const TargetList& exclude, ZoneScope scope) {
+    TargetList targets;
+    k = std::min(k, TargetList::kCapacity);
+    if (k == 0) return targets;
 
-    for (const auto& [peer_id, metrics] : peer_metrics_) {
-        float score = 1.5f / (metrics.queue_length() + 1)
-                    + 2.0f / (metrics.cpu_utilization() + 1)
-                    + 1.0f / ((std::chrono::system_clock::now().time_since_epoch().count() - metrics.last_heartbeat()) + 1)
-                    - metrics.network_latency(); // Lower latency is better
-        scored_peers.emplace_back(peer_id, score);
+    // Best so far in descending score order; one spare slot for the insert
+    std::array<PeerId, TargetList::kCapacity + 1> best;
+    std::array<float, TargetList::kCapacity + 1> best_score;
+    size_t count = 0;
+    float floor = -std::numeric_limits<float>::infinity();
+
+    const float* score = peers.score.data();
+    int64_t now_ticks = now.time_since_epoch().count();
+    size_t n = peers.size();
+    for (size_t block = 0; block < n; block += kScanBlock) {
+        size_t block_end = std::min(n, block + kScanBlock);
+
+        // Once k peers are held, most blocks have nobody above the floor;
+        // test that without branches so the compiler can vectorize it
+        if (count == k) {
+            bool any = false;
+            for (size_t i = block; i < block_end; ++i) any |= score[i] > floor;
+            if (!any) continue;
+        }
+
+        for (size_t i = block; i < block_end; ++i) {
+            if (count == k && score[i] <= floor) continue;
+            PeerId id = static_cast<PeerId>(i);
+            if (peers.suspected(id, now_ticks)) continue; // Suspected peers are never candidates
+            if (exclude.contains(id)) continue;
+            if (scope != ZoneScope::kAll &&
+                (peers.zone[id] == PeerZone::kSame) != (scope == ZoneScope::kOwnZone)) continue;
+
+            size_t pos = count;
+            while (pos > 0 && score[i] > best_score[pos - 1]) {
+                best[pos] = best[pos - 1];
+                best_score[pos] = best_score[pos - 1];
+                --pos;
+            }
+            best[pos] = id;
+            best_score[pos] = score[i];
+            if (count < k) ++count;
+            if (count == k) floor = best_score[k - 1];
+        }
     }
 
-    // Fallback if metrics are not yet available
-    if (scored_peers.empty()) {
-        return {peers_.begin(), peers_.begin() + std::min<size_t>(peers_.size(), 2)};
+    for (size_t i = 0; i < count; ++i) targets.push_back(best[i]);
+    return targets;
+}
+
+TargetList TARAlgorithm::selectByScore(const PeerTable& peers, size_t k, PhiAccrualDetector::Clock::time_point now,
+                                       const TargetList& exclude) const {
+    if (!hierarchical_) return selectTopK(peers, k, now, exclude);
+
+    // Other zones are only live here through their leaders, so this spills
+    // to a neighbouring zone only when the own zone is too small
+    TargetList targets = selectTopK(peers, k, now, exclude, ZoneScope::kOwnZone);
+    if (targets.size() < k) {
+        for (PeerId id : selectTopK(peers, k - targets.size(), now, exclude, ZoneScope::kOtherZones)) {
+            targets.push_back(id);
+        }
+    }
+    return targets;
+}
+
+TargetList TARAlgorithm::selectTargets(const PeerTable& peers, const tar::Task& task, size_t k,
+                                       PhiAccrualDetector::Clock::time_point now) const {
+    return affinity_routing_ ? selectAffinityTargets(peers, task, k, now) : selectByScore(peers, k, now);
+}
+
+std::string_view TARAlgorithm::affinityKey(const tar::Task& task) const {
+    std::string_view field = affinity_key_from_payload_ ? task.payload() : task.id();
+    size_t end = affinity_key_delimiter_.empty() ? std::string_view::npos : field.find(affinity_key_delimiter_);
+    return field.substr(0, std::min(end, kMaxAffinityKeyBytes));
+}
+
+TargetList TARAlgorithm::selectAffinityTargets(const PeerTable& peers, const tar::Task& task, size_t k,
+                                               PhiAccrualDetector::Clock::time_point now) const {
+    auto ring = affinitySnapshot();
+    std::string_view key = affinityKey(task);
+    k = std::min(k, TargetList::kCapacity);
+
+    // Down or never-heard-from members are passed over, so their keys move to
+    // the next member clockwise and come back when they do
+    TargetList preferred;
+    int64_t now_ticks = now.time_since_epoch().count();
+    ring->walk(HashRing::hash(key.data(), key.size()), [&](uint32_t member) {
+        PeerId id = member == 0 ? kSelfPeer : member - 1;
+        if (id != kSelfPeer) {
+            // The ring can be newer than the table this task was routed against
+            if (id >= peers.size() || peers.suspected(id, now_ticks)) return true;
+            if (hierarchical_ && peers.zone[id] != PeerZone::kSame) return true; // Keys stay in the zone
+        }
+        if (!preferred.contains(id)) preferred.push_back(id);
+        return preferred.size() < k;
+    });
+
+    // A peer below the stealing threshold is never too loaded to keep its keys
+    float mean = peers.heard ? static_cast<float>(peers.total_queue_length) / peers.heard : 0.0f;
+    float bound = std::max(affinity_load_bound_ * (mean + 1.0f), affinity_min_bound_);
+    TargetList targets;
+    for (PeerId id : preferred) {
+        size_t queue_length = id == kSelfPeer ? task_queue_.size() : peers.queue_length[id];
+        if (queue_length <= bound) targets.push_back(id);
+    }
+
+    bool spilled = targets.size() < preferred.size();
+    (spilled ? GetServerStats().affinity_spilled : GetServerStats().affinity_preferred).fetch_add(1, std::memory_order_relaxed);
+    if (targets.size() == k) return targets;
+
+    // Fill the remaining slots by load score, never with a preferred member
+    for (PeerId id : selectByScore(peers, k - targets.size(), now, preferred)) targets.push_back(id);
+    return targets;
+}
+
+AdmissionDecision TARAlgorithm::admitTask(const tar::Task& task, const PeerTable& peers,
+                                          const TargetList& targets) const {
+    // Only work at the task's priority or above runs before it
+    int priority = std::clamp<int>(task.priority(), 0, tar::Priority_ARRAYSIZE - 1);
+    auto tasks_ahead = [priority](auto&& queue_length) {
+        int64_t ahead = 0;
+        for (int level = priority; level < tar::Priority_ARRAYSIZE; ++level) ahead += queue_length(level);
+        return ahead;
+    };
+
+    std::array<CandidateLoad, TargetList::kCapacity + 1> candidates;
+    size_t count = 0;
+    candidates[count++] = CandidateLoad{
+        tasks_ahead([this](int level) { return task_queue_.size(static_cast<tar::Priority>(level)); }),
+        service_rate_.serviceRate(), service_rate_.serviceTimeMs()};
+    for (PeerId id : targets) {
+        if (id == kSelfPeer) continue; // Already the first candidate
+        const tar::ServerMetrics& metrics = *peers.metrics[id]; // Targets were all heard from
+        // Peers that predate the per-priority lengths only report a total
+        int64_t ahead = metrics.queue_length_by_priority_size() == tar::Priority_ARRAYSIZE
+            ? tasks_ahead([&](int level) { return metrics.queue_length_by_priority(level); })
+            : metrics.queue_length();
+        candidates[count++] = CandidateLoad{ahead, metrics.service_rate(), metrics.service_time_ms()};
+    }
+
+    auto decision = admission_.admit(task, candidates.data(), count, clock_.wallNanos());
+    if (decision.verdict == AdmissionDecision::kShed) {
+        GetServerStats().tasks_shed[priority].fetch_add(1, std::memory_order_relaxed);
+    } else if (decision.verdict == AdmissionDecision::kDeadlineMiss) {
+        GetServerStats().deadline_rejections[priority].fetch_add(1, std::memory_order_relaxed);
+    }
+    if (!decision.admitted()) {
+        LOG_DEBUG("Admission", "Rejected task ", task.id(), ": ", decision.reason);
     }
+    return decision;
+}
+
+// Used until the first heartbeat arrives: the first two startup peers
+static TargetList fallbackTargets(const PeerTable& peers) {
+    TargetList targets;
+    for (PeerId id = 0; id < std::min<size_t>(peers.size(), 2); ++id) targets.push_back(id);
+    return targets;
+}
 
-    std::sort(scored_peers.begin(), scored_peers.end(),
-              [](const auto& a, const auto& b) { return a.second > b.second; });
+TargetList TARAlgorithm::routeTask(std::shared_ptr<tar::Task> task, const tar::ServerMetrics&,
+                                   AdmissionDecision* admission) {
+    auto peer_metrics = peerMetricsSnapshot();
 
-    int replication_factor = (task.priority() == tar::Priority::URGENT) ? 3 :
-                             (task.priority() == tar::Priority::MODERATE) ? 2 : 1;
+    // Fallback if metrics are not yet available
+    if (peer_metrics->heard == 0) {
+        auto targets = fallbackTargets(*peer_metrics);
+        task->clear_targets();
+        for (PeerId id : targets) task->add_targets(peer_metrics->directory->names[id]);
+        return targets;
+    }
 
-    std::vector<std::string> selected;
-    for (int i = 0; i < std::min(replication_factor, (int)scored_peers.size()); ++i) {
-        selected.push_back(scored_peers[i].first);
+    auto selected = selectTargets(*peer_metrics, *task, replicationFactor(task->priority()), clock_.now());
+    if (admission) {
+        *admission = admitTask(*task, *peer_metrics, selected);
+        if (!admission->admitted()) return {};
     }
 
-    task_queue_[task.id()] = task; // store locally
+    holdRouted(std::move(task), *peer_metrics, selected);
     return selected;
 }
 
+std::vector<TargetList> TARAlgorithm::routeTaskBatch(
+        const std::vector<std::shared_ptr<tar::Task>>& tasks, const tar::ServerMetrics&,
+        std::vector<AdmissionDecision>* admissions) {
+    auto peer_metrics = peerMetricsSnapshot();
+
+    // Rank once for the largest replication factor; each task takes a prefix.
+    // Affinity routing places every task by its own key instead.
+    auto now = clock_.now();
+    bool no_metrics = peer_metrics->heard == 0;
+    bool per_task = affinity_routing_ && !no_metrics;
+    TargetList ranked;
+    if (no_metrics) {
+        ranked = fallbackTargets(*peer_metrics);
+    } else if (!per_task) {
+        ranked = selectByScore(*peer_metrics, replicationFactor(tar::Priority::URGENT), now);
+    }
+    if (admissions) admissions->assign(tasks.size(), AdmissionDecision());
+
+    std::vector<TargetList> results;
+    results.reserve(tasks.size());
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        const auto& task = tasks[i];
+        TargetList targets;
+        if (per_task) {
+            targets = selectAffinityTargets(*peer_metrics, *task, replicationFactor(task->priority()), now);
+        } else {
+            // Keep the single-task fallback behaviour when no metrics are known yet
+            size_t count = no_metrics ? ranked.size()
+                                      : std::min<size_t>(replicationFactor(task->priority()), ranked.size());
+            for (size_t j = 0; j < count; ++j) targets.push_back(ranked[j]);
+        }
+        if (admissions && !no_metrics) {
+            // Tasks admitted earlier in the batch already count in the local queue
+            (*admissions)[i] = admitTask(*task, *peer_metrics, targets);
+            if (!(*admissions)[i].admitted()) {
+                results.emplace_back();
+                continue;
+            }
+        }
+        results.push_back(targets);
+        holdRouted(task, *peer_metrics, targets);
+    }
+
+    return results;
+}
+
+void TARAlgorithm::holdRouted(std::shared_ptr<tar::Task> task, const PeerTable& peers, const TargetList& targets) {
+    // Set before the task is shared with the queue and the replicas
+    task->clear_targets();
+    for (PeerId id : targets) task->add_targets(peerName(*peers.directory, id));
+    holdTask(std::move(task));
+}
+
+void TARAlgorithm::holdTask(std::shared_ptr<tar::Task> task) {
+    if (task_log_) task_log_->append(*task);
+    placeTask(std::move(task));
+}
+
+void TARAlgorithm::placeTask(std::shared_ptr<tar::Task> task) {
+    if (task->targets().empty() || task->targets(0) == self_id_) {
+        task_queue_.push(std::move(task));
+        return;
+    }
+
+    std::string id = task->id(); // Copy before the task is moved into the entry
+    std::lock_guard<std::mutex> lock(standby_mutex_);
+    standby_[std::move(id)] = StandbyTask{std::move(task), clock_.now()};
+}
+
+void TARAlgorithm::holdReplica(tar::Task task) {
+    LOG_DEBUG("Task Queue", "Holding replica: ", task.id());
+    holdTask(std::make_shared<tar::Task>(std::move(task)));
+}
+
+void TARAlgorithm::giveAway(tar::Task& task, const std::string& thief) {
+    // The thief goes first; the rest keep their order behind it
+    task.add_targets(thief);
+    std::rotate(task.mutable_targets()->begin(), task.mutable_targets()->end() - 1, task.mutable_targets()->end());
+    holdTask(std::make_shared<tar::Task>(task));
+}
+
+size_t TARAlgorithm::promoteStandbyTasks() {
+    auto peer_metrics = peerMetricsSnapshot();
+    auto now = clock_.now();
+    int64_t now_ticks = now.time_since_epoch().count();
+    auto live = [&](const std::string& server) {
+        if (server == self_id_) return true;
+        auto it = peer_metrics->directory->ids.find(server);
+        return it != peer_metrics->directory->ids.end() && !peer_metrics->suspected(it->second, now_ticks);
+    };
+
+    // Holders in order: the targets, then the coordinator. The first live one runs the task.
+    auto runs_here = [&](const tar::Task& task) {
+        for (const auto& target : task.targets()) {
+            if (live(target)) return target == self_id_;
+        }
+        return task.coordinator_id() == self_id_;
+    };
+
+    std::vector<std::shared_ptr<tar::Task>> promoted;
+    {
+        std::lock_guard<std::mutex> lock(standby_mutex_);
+        for (auto it = standby_.begin(); it != standby_.end();) {
+            if (now - it->second.since >= standby_grace_ && runs_here(*it->second.task)) {
+                promoted.push_back(std::move(it->second.task));
+                it = standby_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for (auto& task : promoted) {
+        task_queue_.push(std::move(task)); // Still in the task log from when it was held
+    }
+    if (!promoted.empty()) {
+        LOG_INFO("Standby", "Took over ", promoted.size(), " tasks from failed executors");
+        GetServerStats().standby_promotions.fetch_add(promoted.size(), std::memory_order_relaxed);
+    }
+    return promoted.size();
+}
+
+size_t TARAlgorithm::getStandbyCount() const {
+    std::lock_guard<std::mutex> lock(standby_mutex_);
+    return standby_.size();
+}
+
+std::vector<std::string> TARAlgorithm::peerNames(const TargetList& targets) const {
+    // Ids are never reused, so any directory at least as new as the routing one resolves them
+    auto directory = peerMetricsSnapshot()->directory;
+    std::vector<std::string> names;
+    names.reserve(targets.size());
+    for (PeerId id : targets) names.push_back(peerName(*directory, id));
+    return names;
+}
+
 bool TARAlgorithm::acknowledgeTask(const tar::TaskAck& ack) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    std::cout << "[ACK] Task: " << ack.task_id() << " acknowledged by server: " << ack.server_id() << std::endl;
+    LOG_DEBUG("ACK", "Task: ", ack.task_id(), " acknowledged by server: ", ack.server_id());
+
+    // Replica acks arrive with the ReplicateTasks reply; this is a completion,
+    // so the copy held here no longer needs to run
+    if (!ack.success()) return false;
+    bool dropped = task_queue_.remove(ack.task_id());
+    {
+        std::lock_guard<std::mutex> lock(standby_mutex_);
+        dropped = standby_.erase(ack.task_id()) > 0 || dropped;
+    }
+    if (task_log_) task_log_->remove(ack.task_id()); // Even if it is running here right now
+    if (!dropped) {
+        LOG_DEBUG("ACK", "Task ", ack.task_id(), " is no longer queued here.");
+    }
+    return dropped;
+}
+
+void TARAlgorithm::updateServerMetrics(const tar::ServerMetrics& metrics, MetricsSource source) {
+    {
+        TimedLockGuard lock(metrics_write_mutex_, GetServerStats().metrics_lock_wait);
+        auto current = peerMetricsSnapshot();
+        auto known = current->directory->ids.find(metrics.server_id());
+        const tar::ServerMetrics* previous =
+            known != current->directory->ids.end() ? current->metrics[known->second].get() : nullptr;
+
+        // Requests, replies and gossip arrive in any order, so an older copy
+        // must not replace newer metrics; a reply still proves the peer is alive
+        bool reply = source == MetricsSource::kHeartbeatReply;
+        bool newer = !previous || metrics.last_heartbeat() > previous->last_heartbeat();
+        if (!newer && !reply) return;
 
-    // Updated log to reflect the lack of full commitment tracking
-    std::cout << "[INFO] Task " << ack.task_id() << " acknowledgment received. Commitment tracking is not implemented yet." << std::endl;
+        auto stored = std::make_shared<tar::ServerMetrics>(newer ? metrics : *previous);
+        stored->clear_zone_loads(); // Merged into zone_loads_ below; n copies of them would be O(n * zones)
+        if (source == MetricsSource::kHeartbeatRequest) {
+            // Requests carry no latency; keep the one our own round trips measured
+            stored->set_network_latency(previous ? previous->network_latency() : 0.0f);
+        } else {
+            stored->set_network_latency(metrics.network_latency());
+        }
+
+        auto updated = std::make_shared<PeerTable>(*current);
+        std::shared_ptr<HashRing> ring;
+        PeerId id;
+        if (known != current->directory->ids.end()) {
+            id = known->second;
+        } else {
+            // A peer outside peers_: the directory (and ring) are copied only here
+            auto directory = std::make_shared<PeerDirectory>(*updated->directory);
+            id = directory->intern(metrics.server_id());
+            updated->directory = std::move(directory);
+            updated->resize(id + 1);
+            if (affinity_routing_) {
+                ring = std::make_shared<HashRing>(*affinitySnapshot());
+                ring->add(metrics.server_id());
+            }
+        }
+
+        if (reply || (source == MetricsSource::kGossip && newer)) {
+            // Gossip mode has no replies; each new version counts once, whichever path brought it
+            updated->suspect_after[id] =
+                failure_detector_.heartbeat(metrics.server_id(), clock_.now()).time_since_epoch().count();
+        }
+
+        // Score once here so routing only has to compare cached values
+        int64_t heartbeat_age = clock_.wallNanos() - stored->last_heartbeat();
+        if (!updated->metrics[id]) ++updated->heard;
+        updated->total_queue_length += stored->queue_length() - updated->queue_length[id];
+        updated->score[id] = scoreServer(stored->queue_length(), stored->cpu_utilization(),
+                                         heartbeat_age, stored->network_latency());
+        updated->queue_length[id] = stored->queue_length();
+        updated->zone[id] = placePeer(*stored, updated->zone[id]);
+        updated->metrics[id] = std::move(stored);
+
+        std::atomic_store_explicit(&peer_metrics_, std::shared_ptr<const PeerTable>(std::move(updated)),
+                                   std::memory_order_release);
+        if (ring) {
+            // After the snapshot, so a reader holding an older snapshot only
+            // sees members it can bounds-check away
+            std::atomic_store_explicit(&affinity_ring_, std::shared_ptr<const HashRing>(std::move(ring)),
+                                       std::memory_order_release);
+        }
+    }
+    if (hierarchical_ && metrics.zone_loads_size() > 0) {
+        std::lock_guard<std::mutex> lock(zone_mutex_);
+        for (const auto& load : metrics.zone_loads()) {
+            auto it = zone_loads_.find(load.zone());
+            if (it == zone_loads_.end()) {
+                zone_loads_.emplace(load.zone(), load);
+            } else if (load.updated_at() > it->second.updated_at()) {
+                it->second = load;
+            }
+        }
+        // Inferred zones are named after their leader, so old names go stale
+        int64_t now = clock_.wallNanos();
+        for (auto it = zone_loads_.begin(); it != zone_loads_.end();) {
+            it = now - it->second.updated_at() > zone_load_ttl_nanos_ ? zone_loads_.erase(it) : std::next(it);
+        }
+    }
+    LOG_DEBUG("Heartbeat", "Updated metrics from ", metrics.server_id());
+}
 
-    return true;  // Extend for quorum logic later
+PeerZone TARAlgorithm::placePeer(const tar::ServerMetrics& metrics, PeerZone previous) const {
+    if (!hierarchical_) return previous;
+    if (!zone_.empty() && !metrics.zone().empty()) {
+        return metrics.zone() == zone_ ? PeerZone::kSame : PeerZone::kOther;
+    }
+    // Only our own round trips measure latency; a peer never measured stays where it was
+    if (metrics.network_latency() > 0.0f) {
+        return metrics.network_latency() <= zone_latency_ms_ ? PeerZone::kSame : PeerZone::kOther;
+    }
+    return previous;
 }
 
-void TARAlgorithm::updateServerMetrics(const tar::ServerMetrics& metrics) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    peer_metrics_[metrics.server_id()] = metrics;
-    std::cout << "[HEARTBEAT] Updated metrics from " << metrics.server_id() << std::endl;
+tar::ServerMetrics TARAlgorithm::getLocalMetrics() const {
+    tar::ServerMetrics metrics;
+    metrics.set_server_id(self_id_);
+    metrics.set_cpu_utilization(local_cpu_utilization_);
+    metrics.set_queue_length(getTaskQueueLength());
+    for (int priority = 0; priority < tar::Priority_ARRAYSIZE; ++priority) {
+        metrics.add_queue_length_by_priority(task_queue_.size(static_cast<tar::Priority>(priority)));
+    }
+    metrics.set_service_rate(service_rate_.serviceRate());
+    metrics.set_service_time_ms(service_rate_.serviceTimeMs());
+    metrics.set_last_heartbeat(clock_.wallNanos());
+    if (hierarchical_) {
+        metrics.set_zone(getZone());
+        metrics.set_zone_leader(isZoneLeader());
+        // Leaders carry the summaries, to other leaders and down to their zone
+        if (metrics.zone_leader()) {
+            for (auto& load : getZoneLoads()) {
+                *metrics.add_zone_loads() = std::move(load);
+            }
+        }
+    }
+    return metrics;
 }
 
 std::optional<tar::Task> TARAlgorithm::requestTaskTransfer(const tar::ServerMetrics& requester) {
     int max_hop_count = GetEnvOrDefault("MAX_HOP_COUNT", 2);
 
-    std::lock_guard<std::mutex> lock(mutex_);
+    auto task = task_queue_.takeTransferable(max_hop_count);
+    if (!task) {
+        return std::nullopt; // No transferable task found
+    }
 
-    for (auto it = task_queue_.begin(); it != task_queue_.end(); ++it) {
-        tar::Task& task = it->second;
+    // Increment the hop count and transfer the task
+    task->set_hop_count(task->hop_count() + 1);
+    giveAway(*task, requester.server_id());
+    GetServerStats().tasks_transferred.fetch_add(1, std::memory_order_relaxed);
+    return task;
+}
 
-        // Check if the task has reached the maximum hop count
-        if (task.hop_count() >= max_hop_count) {
-            std::cout << "[Task Transfer] Task " << task.id() << " has reached max hop count. Skipping." << std::endl;
-            continue; // Skip this task and check the next one
-        }
+std::vector<tar::Task> TARAlgorithm::stealTasks(const tar::ServerMetrics& thief, int max_tasks) {
+    int max_hop_count = GetEnvOrDefault("MAX_HOP_COUNT", 2);
 
-        // Increment the hop count and transfer the task
+    // Split the imbalance instead of swapping it, so tasks do not bounce back
+    int gap = getTaskQueueLength() - thief.queue_length();
+    int count = std::min(max_tasks, gap / 2);
+    if (count <= 0) return {};
+
+    auto tasks = task_queue_.takeTransferableBatch(max_hop_count, count);
+    for (auto& task : tasks) {
         task.set_hop_count(task.hop_count() + 1);
-        tar::Task transferred_task = task;
-        task_queue_.erase(it); // Remove the task from the queue
-        return transferred_task;
+        giveAway(task, thief.server_id());
+    }
+    GetServerStats().tasks_transferred.fetch_add(tasks.size(), std::memory_order_relaxed);
+    return tasks;
+}
+
+std::vector<tar::ServerMetrics> TARAlgorithm::getOverloadedPeers(int threshold) const {
+    auto peer_metrics = peerMetricsSnapshot();
+
+    // Another zone's leader is a victim only while its zone as a whole is
+    // overloaded and busier than ours
+    std::unordered_map<std::string, float> zone_mean;
+    float own_zone_mean = static_cast<float>(getTaskQueueLength());
+    if (hierarchical_) {
+        std::string own_zone = getZone();
+        for (const auto& load : getZoneLoads()) {
+            float mean = static_cast<float>(load.queue_length()) / std::max(1, load.members());
+            if (load.zone() == own_zone) {
+                own_zone_mean = mean;
+            } else {
+                zone_mean[load.zone()] = mean;
+            }
+        }
     }
 
-    return std::nullopt; // No transferable task found
+    int64_t now_ticks = clock_.now().time_since_epoch().count();
+    std::vector<PeerId> overloaded;
+    for (PeerId id = 0; id < peer_metrics->size(); ++id) {
+        if (peer_metrics->queue_length[id] <= threshold || peer_metrics->suspected(id, now_ticks)) continue;
+        if (hierarchical_ && peer_metrics->zone[id] != PeerZone::kSame) {
+            auto mean = zone_mean.find(peer_metrics->metrics[id]->zone());
+            if (mean == zone_mean.end() || mean->second <= threshold || mean->second <= own_zone_mean) continue;
+        }
+        overloaded.push_back(id);
+    }
+
+    if (!hierarchical_) {
+        std::sort(overloaded.begin(), overloaded.end(), [&](PeerId a, PeerId b) {
+            return peer_metrics->queue_length[a] > peer_metrics->queue_length[b];
+        });
+    } else {
+        // Zone members first, then by tasks on offer per millisecond of round trip
+        auto rank = [&](PeerId id) {
+            return peer_metrics->queue_length[id] / (1.0f + peer_metrics->metrics[id]->network_latency());
+        };
+        std::sort(overloaded.begin(), overloaded.end(), [&](PeerId a, PeerId b) {
+            bool a_remote = peer_metrics->zone[a] != PeerZone::kSame;
+            bool b_remote = peer_metrics->zone[b] != PeerZone::kSame;
+            return a_remote != b_remote ? b_remote : rank(a) > rank(b);
+        });
+    }
+
+    std::vector<tar::ServerMetrics> victims;
+    victims.reserve(overloaded.size());
+    for (PeerId id : overloaded) victims.push_back(*peer_metrics->metrics[id]);
+    return victims;
 }
 
 bool TARAlgorithm::shouldBecomeCoordinator() const {
     return true; // Always true for now
 }
 
-void TARAlgorithm::addTaskToQueue(const tar::Task& task) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    task_queue_[task.id()] = task;
-    std::cout << "[Task Queue] Added task: " << task.id() << std::endl;
+void TARAlgorithm::addTaskToQueue(tar::Task task) {
+    LOG_DEBUG("Task Queue", "Added task: ", task.id());
+    if (task_log_) task_log_->append(task);
+    task_queue_.push(std::move(task));
 }
 
 std::string TARAlgorithm::electLeader() {
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    std::vector<std::pair<std::string, float>> scored_peers;
-
-    // Calculate scores for all peers, including self
-    for (const auto& [peer_id, metrics] : peer_metrics_) {
-        float score = 1.5f / (metrics.queue_length() + 1)
-                    + 2.0f / (metrics.cpu_utilization() + 1)
-                    + 1.0f / ((std::chrono::system_clock::now().time_since_epoch().count() - metrics.last_heartbeat()) + 1)
-                    - metrics.network_latency(); // Lower latency is better
-        scored_peers.emplace_back(peer_id, score);
+    if (hierarchical_) {
+        // Scores are observer-relative (latency, and every server rates
+        // itself as fully responsive), so zone members would each pick a
+        // different winner. The lowest live id is one they all agree on.
+        std::string leader = zoneLeaderCandidate();
+        std::lock_guard<std::mutex> lock(leader_mutex_);
+        current_leader_ = leader;
+        GetServerStats().elections.fetch_add(1, std::memory_order_relaxed);
+        LOG_INFO("Leader Election", "New zone leader elected: ", current_leader_);
+        return current_leader_;
     }
 
+    auto peer_metrics = peerMetricsSnapshot();
+
     // Add self to the scoring
-    float self_score = 1.5f / (task_queue_.size() + 1)
-                     + 2.0f / (0.5 + 1) // Example CPU utilization for self
-                     + 1.0f / 1; // Assume self is always responsive
-    scored_peers.emplace_back(self_id_, self_score);
+    float self_score = scoreServer(task_queue_.size(),
+                                   0.5f, // Example CPU utilization for self
+                                   0,    // Assume self is always responsive
+                                   0.0f);
 
-    // Sort peers by score in descending order
-    std::sort(scored_peers.begin(), scored_peers.end(),
-              [](const auto& a, const auto& b) { return a.second > b.second; });
+    std::string leader = self_id_;
+    auto best = selectTopK(*peer_metrics, 1, clock_.now());
+    if (!best.empty() && peer_metrics->score[best[0]] > self_score) {
+        leader = peer_metrics->directory->names[best[0]];
+    }
 
     // The peer with the highest score becomes the leader
-    current_leader_ = scored_peers.front().first;
-    std::cout << "[Leader Election] New leader elected: " << current_leader_ << std::endl;
+    std::lock_guard<std::mutex> lock(leader_mutex_);
+    current_leader_ = leader;
+    GetServerStats().elections.fetch_add(1, std::memory_order_relaxed);
+    LOG_INFO("Leader Election", "New leader elected: ", current_leader_);
 
     return current_leader_;
 }
 
 std::string TARAlgorithm::getCurrentLeader() const {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> lock(leader_mutex_);
     return current_leader_;
 }
+
+std::string TARAlgorithm::zoneLeaderCandidate() const {
+    auto peer_metrics = peerMetricsSnapshot();
+    int64_t now_ticks = clock_.now().time_since_epoch().count();
+    const std::string* leader = &self_id_;
+    for (PeerId id = 0; id < peer_metrics->size(); ++id) {
+        // Unplaced peers may turn out to be remote, so only placed members run
+        if (peer_metrics->zone[id] != PeerZone::kSame || peer_metrics->suspected(id, now_ticks)) continue;
+        const std::string& name = peer_metrics->directory->names[id];
+        if (name < *leader) leader = &name;
+    }
+    return *leader;
+}
+
+bool TARAlgorithm::needsElection() const {
+    std::string leader = getCurrentLeader();
+    if (leader.empty()) return true;
+    if (hierarchical_) return leader != zoneLeaderCandidate();
+    return isSuspected(leader);
+}
+
+std::string TARAlgorithm::getZone() const {
+    return zone_.empty() ? getCurrentLeader() : zone_;
+}
+
+bool TARAlgorithm::isZoneLeader() const {
+    return hierarchical_ && getCurrentLeader() == self_id_;
+}
+
+PeerZone TARAlgorithm::getPeerZone(const std::string& server_id) const {
+    auto peer_metrics = peerMetricsSnapshot();
+    auto it = peer_metrics->directory->ids.find(server_id);
+    return it != peer_metrics->directory->ids.end() ? peer_metrics->zone[it->second] : PeerZone::kUnplaced;
+}
+
+bool TARAlgorithm::shouldHeartbeat(const std::string& server_id) const {
+    if (!hierarchical_) return true;
+
+    auto peer_metrics = peerMetricsSnapshot();
+    auto it = peer_metrics->directory->ids.find(server_id);
+    if (it == peer_metrics->directory->ids.end()) return true;
+    PeerId id = it->second;
+    if (peer_metrics->zone[id] != PeerZone::kOther) return true;
+    if (!isZoneLeader()) return false;
+
+    // Zone leaders talk to each other; a zone whose leader we do not know
+    // (yet, or any more) gets heartbeats until its new leader answers
+    const tar::ServerMetrics& peer = *peer_metrics->metrics[id];
+    int64_t now_ticks = clock_.now().time_since_epoch().count();
+    if (peer.zone_leader() && !peer_metrics->suspected(id, now_ticks)) return true;
+    for (PeerId other = 0; other < peer_metrics->size(); ++other) {
+        if (peer_metrics->zone[other] != PeerZone::kOther || peer_metrics->suspected(other, now_ticks)) continue;
+        const tar::ServerMetrics& candidate = *peer_metrics->metrics[other];
+        if (candidate.zone_leader() && candidate.zone() == peer.zone()) return false;
+    }
+    return true;
+}
+
+tar::ZoneLoad TARAlgorithm::summarizeZone(const std::string& zone) const {
+    auto peer_metrics = peerMetricsSnapshot();
+    int64_t now_ticks = clock_.now().time_since_epoch().count();
+
+    tar::ZoneLoad load;
+    load.set_zone(zone);
+    load.set_leader_id(self_id_);
+    int members = 1;
+    int64_t queue_length = getTaskQueueLength();
+    float service_rate = service_rate_.serviceRate();
+    for (PeerId id = 0; id < peer_metrics->size(); ++id) {
+        if (peer_metrics->zone[id] != PeerZone::kSame || peer_metrics->suspected(id, now_ticks)) continue;
+        ++members;
+        queue_length += peer_metrics->queue_length[id];
+        service_rate += peer_metrics->metrics[id]->service_rate();
+    }
+    load.set_members(members);
+    load.set_queue_length(queue_length);
+    load.set_service_rate(service_rate);
+    load.set_updated_at(clock_.wallNanos());
+    return load;
+}
+
+std::vector<tar::ZoneLoad> TARAlgorithm::getZoneLoads() const {
+    std::vector<tar::ZoneLoad> loads;
+    if (!hierarchical_) return loads;
+
+    std::string own_zone = getZone();
+    bool leader = isZoneLeader();
+    if (leader) loads.push_back(summarizeZone(own_zone));
+
+    int64_t now = clock_.wallNanos();
+    std::lock_guard<std::mutex> lock(zone_mutex_);
+    for (const auto& [zone, load] : zone_loads_) {
+        if (leader && zone == own_zone) continue;
+        if (now - load.updated_at() > zone_load_ttl_nanos_) continue;
+        loads.push_back(load);
+    }
+    return loads;
+}
+
+bool TARAlgorithm::isSuspected(const std::string& server_id) const {
+    if (server_id == self_id_) return false;
+
+    auto peer_metrics = peerMetricsSnapshot();
+    auto it = peer_metrics->directory->ids.find(server_id);
+    return it == peer_metrics->directory->ids.end() ||
+           peer_metrics->suspected(it->second, clock_.now().time_since_epoch().count());
+}
@@ -5,45 +5,278 @@
 #include <unordered_map>
 #include <optional>
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include <string_view>
+#include <map>
 #include "tar.pb.h"
+#include "TaskQueue.hpp"
+#include "ReplicationTracker.hpp"
+#include "FailureDetector.hpp"
+#include "Clock.hpp"
+#include "TaskLog.hpp"
+#include "AdmissionControl.hpp"
+#include "HashRing.hpp"
+#include "PeerTable.hpp"
 
 class TARAlgorithm {
 public:
-    TARAlgorithm(const std::string& self_id, const std::vector<std::string>& peers);
+    TARAlgorithm(const std::string& self_id, const std::vector<std::string>& peers,
+                 const ClockSource& clock = ClockSource::real());
 
-    // Main task routing function
-    std::vector<std::string> routeTask(const tar::Task& task, const tar::ServerMetrics& requester);
+    // Main task routing function. The task is queued by reference, so the
+    // caller can hand the same message to the replicator without copying it.
+    // With an admission out-parameter the task first goes through admission
+    // control; a rejected task is not queued and gets no targets.
+    TargetList routeTask(std::shared_ptr<tar::Task> task, const tar::ServerMetrics& requester,
+                         AdmissionDecision* admission = nullptr);
 
-    // Acknowledge replication
+    // Route several tasks against one snapshot of peer metrics; one target list per task
+    // (and one admission decision per task when admissions is given)
+    std::vector<TargetList> routeTaskBatch(const std::vector<std::shared_ptr<tar::Task>>& tasks,
+                                           const tar::ServerMetrics& requester,
+                                           std::vector<AdmissionDecision>* admissions = nullptr);
+
+    // Server names of routed peers, for the gRPC layer
+    std::vector<std::string> peerNames(const TargetList& targets) const;
+
+    // Every task runs on one server, its first target (or the coordinator when
+    // it has no targets); the coordinator and the other targets hold standby
+    // copies. The executor acks completion to all of them. A standby copy is
+    // queued here only once it is older than STANDBY_GRACE_MS and its executor
+    // and every holder ranked before this server are suspected.
+
+    // A task this server holds finished elsewhere; drops the local copy and
+    // returns false if there was none
     bool acknowledgeTask(const tar::TaskAck& ack);
 
-    // Update peer metrics
-    void updateServerMetrics(const tar::ServerMetrics& metrics);
+    // Keep a replica received from its coordinator: queued when this server
+    // is its executor, on standby otherwise
+    void holdReplica(tar::Task task);
+
+    // Queue the standby tasks this server has taken over; returns how many
+    size_t promoteStandbyTasks();
+
+    size_t getStandbyCount() const;
+
+    // Per-task replica acknowledgement state for tasks this server coordinates
+    ReplicationTracker& getReplicationTracker() { return replication_tracker_; }
+
+    // Where peer metrics came from. Only our own heartbeat round trips (or,
+    // in gossip mode, each new gossiped version once) feed the failure
+    // detector, so it sees one arrival per peer per interval, and only they
+    // carry a latency measured by this server.
+    enum class MetricsSource { kHeartbeatReply, kHeartbeatRequest, kGossip };
 
-    // Handle work stealing request
+    // Update peer metrics; metrics no newer (by last_heartbeat) than the stored ones are ignored
+    void updateServerMetrics(const tar::ServerMetrics& metrics, MetricsSource source);
+
+    const std::string& getServerId() const { return self_id_; }
+
+    // Metrics describing this server, used to answer heartbeats
+    tar::ServerMetrics getLocalMetrics() const;
+    void setLocalCpuUtilization(float cpu_utilization) { local_cpu_utilization_ = cpu_utilization; }
+
+    // Handle work stealing request. A given-away task names the requester as
+    // its executor and stays here on standby in case the requester fails.
     std::optional<tar::Task> requestTaskTransfer(const tar::ServerMetrics& requester);
 
+    // Handle a batch steal: give up to max_tasks of the least urgent work
+    // (lowest priority, then latest deadline; see TaskQueue::takeTransferableBatch),
+    // never more than half the queue-length gap to the thief; standby as above
+    std::vector<tar::Task> stealTasks(const tar::ServerMetrics& thief, int max_tasks);
+
+    // Last reported metrics of live peers queueing more than threshold tasks, most loaded first
+    std::vector<tar::ServerMetrics> getOverloadedPeers(int threshold) const;
+
     // Optional coordinator role (for future expansion)
     bool shouldBecomeCoordinator() const;
 
     // New method to get task queue length
     int getTaskQueueLength() const {
-        std::lock_guard<std::mutex> lock(mutex_);
         return task_queue_.size();
     }
+    size_t getTaskQueueLength(tar::Priority priority) const {
+        return task_queue_.size(priority);
+    }
 
     // Add task to queue
-    void addTaskToQueue(const tar::Task& task);
+    void addTaskToQueue(tar::Task task);
+
+    // Take the most urgent queued task for local execution. It stays in the
+    // durable task log until completeTask, so a crash mid-run replays it.
+    std::optional<tar::Task> popTask() { return task_queue_.pop(); }
 
-    // New methods for leader election
+    // A popped task finished running here after service_time
+    void completeTask(const std::string& task_id, std::chrono::nanoseconds service_time) {
+        if (task_log_) task_log_->remove(task_id);
+        service_rate_.recordServiceTime(service_time);
+    }
+
+    // Number of executor workers draining the queue; 0 leaves the service rate unmeasured
+    void setExecutorWorkers(int workers) { service_rate_.setWorkers(workers); }
+
+    // Block until every task queued so far is on disk; no-op without TASK_LOG_DIR
+    void waitForDurability() {
+        if (task_log_) task_log_->waitDurable();
+    }
+
+    // New methods for leader election. In hierarchical mode the leader is
+    // the zone's: the lowest live server id among this server and its zone.
     std::string electLeader();
     std::string getCurrentLeader() const;
 
+    // The leader is missing or suspected, or (hierarchical mode) no longer
+    // the zone's lowest live id
+    bool needsElection() const;
+
+    // True once the failure detector suspects the peer (or it was never heard from)
+    bool isSuspected(const std::string& server_id) const;
+
+    // Hierarchical mode (HIERARCHICAL=1): servers are grouped into zones, by
+    // ZONE or, without it, by measured latency (peers within ZONE_LATENCY_MS
+    // round trip share a zone). Routing and stealing stay inside the zone
+    // first, only zone leaders heartbeat other zones, and across zones they
+    // exchange aggregated ZoneLoad summaries instead of per-server metrics.
+    bool isHierarchical() const { return hierarchical_; }
+
+    // Overrides ZONE; call before the first heartbeat (the simulator runs every node in one process)
+    void setZone(const std::string& zone) { zone_ = zone; }
+
+    // This server's zone: the configured one, or its leader's id when inferred
+    std::string getZone() const;
+    bool isZoneLeader() const;
+
+    // Where the peer's last metrics place it; kUnplaced if never heard from
+    PeerZone getPeerZone(const std::string& server_id) const;
+
+    // Whether to heartbeat the peer this tick: always in flat mode; in
+    // hierarchical mode zone members and unplaced peers, and, from the zone
+    // leader only, other zones' leaders (or all of a zone while it has no live leader)
+    bool shouldHeartbeat(const std::string& server_id) const;
+
+    // Known zone summaries younger than three heartbeat intervals; this
+    // server's own zone is summarized fresh when it leads it
+    std::vector<tar::ZoneLoad> getZoneLoads() const;
+
 private:
+    static constexpr size_t kMaxAffinityKeyBytes = 256;
+    static constexpr size_t kScanBlock = 16; // Peers tested per branch-free pass in selectTopK
+
+    // Which peers selectTopK may pick in hierarchical mode; unplaced peers
+    // are not (yet) zone members
+    enum class ZoneScope { kAll, kOwnZone, kOtherZones };
+
+    static int replicationFactor(tar::Priority priority) {
+        return (priority == tar::Priority::URGENT) ? 3 :
+               (priority == tar::Priority::MODERATE) ? 2 : 1;
+    }
+
+    // Weighted health score shared by routing and leader election; higher is better
+    static float scoreServer(int queue_length, float cpu_utilization, int64_t heartbeat_age, float network_latency);
+
+    // The k (at most TargetList::kCapacity) best-scoring live peers in scope
+    // and not in exclude, best first, in a single O(n) pass over the score column
+    static TargetList selectTopK(const PeerTable& peers, size_t k, PhiAccrualDetector::Clock::time_point now,
+                                 const TargetList& exclude = TargetList(), ZoneScope scope = ZoneScope::kAll);
+
+    // selectTopK, but in hierarchical mode zone members first and other zones
+    // only for the slots they cannot fill
+    TargetList selectByScore(const PeerTable& peers, size_t k, PhiAccrualDetector::Clock::time_point now,
+                             const TargetList& exclude = TargetList()) const;
+
+    // Targets for one task: load-score ranking, or its ring placement in affinity mode
+    TargetList selectTargets(const PeerTable& peers, const tar::Task& task, size_t k,
+                             PhiAccrualDetector::Clock::time_point now) const;
+
+    // The first k live ring members clockwise from the task's key, this server
+    // (kSelfPeer) included. Members over the load bound (a multiple of the mean
+    // peer queue length) give their slot to the best-scoring other peers, so
+    // load scores only matter for hot keys.
+    TargetList selectAffinityTargets(const PeerTable& peers, const tar::Task& task, size_t k,
+                                     PhiAccrualDetector::Clock::time_point now) const;
+
+    const std::string& peerName(const PeerDirectory& directory, PeerId id) const {
+        return id == kSelfPeer ? self_id_ : directory.names[id];
+    }
+
+    // Record the routed targets on the task and keep this server's copy
+    void holdRouted(std::shared_ptr<tar::Task> task, const PeerTable& peers, const TargetList& targets);
+
+    // Log the task and queue it when this server runs it, else keep it on standby
+    void holdTask(std::shared_ptr<tar::Task> task);
+
+    // Queue the task when this server runs it, else keep it on standby; no logging
+    void placeTask(std::shared_ptr<tar::Task> task);
+
+    // Hand a queued task to a thief: it becomes the executor, this server a standby holder
+    void giveAway(tar::Task& task, const std::string& thief);
+
+    // The configured task field up to the first delimiter
+    std::string_view affinityKey(const tar::Task& task) const;
+
+    // Admission check for a task that would be queued here and on targets;
+    // updates the admission counters
+    AdmissionDecision admitTask(const tar::Task& task, const PeerTable& peers, const TargetList& targets) const;
+
+    // Where metrics place a peer; previous is kept when they say nothing new
+    PeerZone placePeer(const tar::ServerMetrics& metrics, PeerZone previous) const;
+
+    // Hierarchical election result: lowest id among self and live zone members
+    std::string zoneLeaderCandidate() const;
+
+    // This server's zone as seen from here; only meaningful on its leader
+    tar::ZoneLoad summarizeZone(const std::string& zone) const;
+
+    // Lock-free read of the current peer metrics snapshot
+    std::shared_ptr<const PeerTable> peerMetricsSnapshot() const {
+        return std::atomic_load_explicit(&peer_metrics_, std::memory_order_acquire);
+    }
+    std::shared_ptr<const HashRing> affinitySnapshot() const {
+        return std::atomic_load_explicit(&affinity_ring_, std::memory_order_acquire);
+    }
+
     std::string self_id_;
     std::vector<std::string> peers_;
-    std::map<std::string, tar::ServerMetrics> peer_metrics_;
-    std::map<std::string, tar::Task> task_queue_;
-    mutable std::mutex mutex_;
+    const ClockSource& clock_;
+
+    // Read-mostly peer metrics: readers grab the current snapshot, writers copy,
+    // modify and publish a new one (RCU-style), so routing never waits on heartbeats
+    std::shared_ptr<const PeerTable> peer_metrics_;
+    std::mutex metrics_write_mutex_; // Serializes snapshot writers only
+    PhiAccrualDetector failure_detector_; // Guarded by metrics_write_mutex_
+
+    // Affinity routing (AFFINITY_ROUTING=1)
+    bool affinity_routing_;
+    bool affinity_key_from_payload_;
+    std::string affinity_key_delimiter_;
+    float affinity_load_bound_; // Allowed queue length as a multiple of the mean peer queue length plus one
+    float affinity_min_bound_;  // ... but never below OVERLOADED_THRESHOLD
+    std::shared_ptr<const HashRing> affinity_ring_; // Member 0 is this server, member i + 1 is PeerId i
+
+    // Hierarchical mode (HIERARCHICAL=1)
+    bool hierarchical_;
+    std::string zone_;         // Empty: inferred from latency
+    float zone_latency_ms_;    // Round trip below which an unzoned peer counts as a zone member
+    int64_t zone_load_ttl_nanos_;
+    mutable std::mutex zone_mutex_;
+    std::map<std::string, tar::ZoneLoad> zone_loads_; // zone -> newest summary received; guarded by zone_mutex_
+
+    struct StandbyTask {
+        std::shared_ptr<tar::Task> task;
+        PhiAccrualDetector::Clock::time_point since;
+    };
+
+    TaskQueue task_queue_;
+    mutable std::mutex standby_mutex_;
+    std::unordered_map<std::string, StandbyTask> standby_; // Held for another executor; guarded by standby_mutex_
+    std::chrono::nanoseconds standby_grace_;
+    std::unique_ptr<TaskLog> task_log_; // Optional write-ahead copy of task_queue_
+    ReplicationTracker replication_tracker_;
+    AdmissionController admission_;
+    ServiceRateEstimator service_rate_;
+
+    mutable std::mutex leader_mutex_;
     std::string current_leader_; // Store the current leader
+    std::atomic<float> local_cpu_utilization_{0.0f};
 };
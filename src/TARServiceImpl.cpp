@@ -1,54 +1,221 @@
 #include "TARServiceImpl.hpp"
-#include <iostream>
+#include "EnvConfig.hpp"
+#include "Stats.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <thread>
 
-TARServiceImpl::TARServiceImpl(const std::string& server_id, const std::vector<std::string>& peers)
-    : algorithm_(server_id, peers) {}
+TARServiceImpl::TARServiceImpl(const std::string& server_id, const std::vector<std::string>& peers,
+                               PeerConnectionManager* peer_connections)
+    : algorithm_(server_id, peers), gossip_(server_id) {
+    if (peer_connections) {
+        replicator_ = std::make_unique<ReplicationDispatcher>(
+            server_id, peer_connections, &algorithm_.getReplicationTracker());
+    }
+}
+
+std::shared_ptr<tar::Task> TARServiceImpl::adoptTask(const tar::Task& task) const {
+    // The only copy of the payload on the routing path: the local queue and
+    // every outgoing replica share this message from here on
+    auto shared = std::make_shared<tar::Task>(task);
+    shared->set_coordinator_id(algorithm_.getServerId());
+    return shared;
+}
+
+grpc::Status TARServiceImpl::replicateAndCommit(std::shared_ptr<tar::Task> task, const std::vector<std::string>& targets) {
+    using Started = ReplicationDispatcher::Started;
+    std::string task_id = task->id();
+    Started started = replicator_ ? replicator_->replicate(std::move(task), targets) : Started::kNoWait;
+    if (started == Started::kDuplicate) {
+        return grpc::Status(grpc::StatusCode::ALREADY_EXISTS, "Task id is already being replicated");
+    }
+
+    // The local copy goes to disk while the replicas are in flight
+    algorithm_.waitForDurability();
+    if (started == Started::kAwaitQuorum && !replicator_->waitForQuorum(task_id)) {
+        return grpc::Status(grpc::StatusCode::UNAVAILABLE, "Replication quorum not reached");
+    }
+    return grpc::Status::OK;
+}
 
 grpc::Status TARServiceImpl::RouteTask(grpc::ServerContext*,
                                        const tar::RouteTaskRequest* request,
                                        tar::RouteTaskResponse* response) {
+    ScopedLatency latency(GetServerStats().route_task);
     if (!request) {
 return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Null request");
 }
 
     // Log the incoming task details
-    std::cout << "[Server] Received RouteTask request:" << std::endl;
-    std::cout << "  Task ID: " << request->task().id() << std::endl;
-    std::cout << "  Priority: " << request->task().priority() << std::endl;
-    std::cout << "  Requester ID: " << request->requester_metrics().server_id() << std::endl;
+    LOG_DEBUG("Server", "Received RouteTask request: task=", request->task().id(),
+              " priority=", tar::Priority_Name(request->task().priority()),
+              " requester=", request->requester_metrics().server_id());
 
-    auto targets = algorithm_.routeTask(request->task(), request->requester_metrics());
+    auto task = adoptTask(request->task());
+    AdmissionDecision admission;
+    auto targets = algorithm_.peerNames(algorithm_.routeTask(task, request->requester_metrics(), &admission));
+    if (!admission.admitted()) {
+        // Fail fast so the client can retry elsewhere or later instead of queueing behind an overload
+        return grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED, admission.reason);
+    }
     response->mutable_target_servers()->Add(targets.begin(), targets.end());
+    response->set_task_id(request->task().id());
     response->set_is_coordinator(algorithm_.shouldBecomeCoordinator());
 
     // Log the routing decision
-    std::cout << "[Server] Task routed to: ";
-    for (const auto& target : targets) {
-        std::cout << target << " ";
+    LOG_INFO("Server", "Task ", request->task().id(), " routed to: ", LogList(targets));
+
+    // Complete the call only once enough replicas have acknowledged
+    grpc::Status status = replicateAndCommit(std::move(task), targets);
+    response->set_committed(status.ok());
+    return status;
+}
+
+grpc::Status TARServiceImpl::RouteTaskBatch(grpc::ServerContext*,
+                                            const tar::RouteTaskBatchRequest* request,
+                                            tar::RouteTaskBatchResponse* response) {
+    if (!request) {
+return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Null request");
+}
+
+    LOG_INFO("Server", "Received RouteTaskBatch request with ", request->tasks_size(),
+             " tasks from: ", request->requester_metrics().server_id());
+
+    std::vector<std::shared_ptr<tar::Task>> tasks;
+    tasks.reserve(request->tasks_size());
+    for (const auto& task : request->tasks()) {
+        tasks.push_back(adoptTask(task));
+    }
+
+    std::vector<AdmissionDecision> admissions;
+    auto routed = algorithm_.routeTaskBatch(tasks, request->requester_metrics(), &admissions);
+    bool is_coordinator = algorithm_.shouldBecomeCoordinator();
+
+    // Peer ids become names only here, at the wire
+    std::vector<std::vector<std::string>> batch_targets;
+    batch_targets.reserve(routed.size());
+    for (const auto& targets : routed) batch_targets.push_back(algorithm_.peerNames(targets));
+
+    // Send every replica first so the whole batch replicates in parallel
+    using Started = ReplicationDispatcher::Started;
+    std::vector<Started> started(batch_targets.size(), Started::kNoWait);
+    for (size_t i = 0; i < batch_targets.size(); ++i) {
+        if (admissions[i].admitted() && replicator_) started[i] = replicator_->replicate(tasks[i], batch_targets[i]);
+    }
+    algorithm_.waitForDurability(); // One group commit covers the whole batch
+
+    response->mutable_results()->Reserve(batch_targets.size());
+    for (size_t i = 0; i < batch_targets.size(); ++i) {
+        const auto& targets = batch_targets[i];
+        auto* result = response->add_results();
+        result->set_task_id(request->tasks(i).id());
+        if (!admissions[i].admitted()) {
+            result->set_rejection_reason(admissions[i].reason);
+            continue;
+        }
+        if (started[i] == Started::kDuplicate) {
+            result->set_rejection_reason("Task id is already being replicated");
+            continue;
+        }
+        result->mutable_target_servers()->Add(targets.begin(), targets.end());
+        result->set_is_coordinator(is_coordinator);
+        result->set_committed(started[i] != Started::kAwaitQuorum || replicator_->waitForQuorum(request->tasks(i).id()));
+    }
+
+    return grpc::Status::OK;
+}
+
+grpc::Status TARServiceImpl::SubmitTasks(grpc::ServerContext* context,
+                                         grpc::ServerReaderWriter<tar::RouteTaskResponse, tar::Task>* stream) {
+    // Above this queue length the stream stops reading, so HTTP/2 flow control
+    // stalls the producer instead of the call failing
+    int high_watermark = GetEnvOrDefault("STREAM_QUEUE_HIGH_WATERMARK", 1000);
+    int max_backoff_ms = GetEnvOrDefault("STREAM_MAX_BACKOFF_MS", 100);
+
+    tar::ServerMetrics requester;
+    requester.set_server_id(context->peer());
+    LOG_INFO("Server", "SubmitTasks stream opened by: ", requester.server_id());
+
+    int routed = 0;
+    while (true) {
+        int backoff_ms = 1;
+        while (algorithm_.getTaskQueueLength() > high_watermark && !context->IsCancelled()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(backoff_ms));
+            backoff_ms = std::min(backoff_ms * 2, max_backoff_ms);
+        }
+
+        // Read straight into the message that gets queued and replicated
+        auto task = std::make_shared<tar::Task>();
+        if (context->IsCancelled() || !stream->Read(task.get())) break;
+        task->set_coordinator_id(algorithm_.getServerId());
+
+        AdmissionDecision admission;
+        auto targets = algorithm_.peerNames(algorithm_.routeTask(task, requester, &admission));
+
+        tar::RouteTaskResponse response;
+        response.set_task_id(task->id());
+        if (!admission.admitted()) {
+            response.set_rejection_reason(admission.reason);
+            if (!stream->Write(response)) break;
+            continue;
+        }
+        response.mutable_target_servers()->Add(targets.begin(), targets.end());
+        response.set_is_coordinator(algorithm_.shouldBecomeCoordinator());
+        grpc::Status status = replicateAndCommit(std::move(task), targets);
+        response.set_committed(status.ok());
+        if (status.error_code() == grpc::StatusCode::ALREADY_EXISTS) {
+            response.set_rejection_reason(status.error_message());
+        }
+        if (!stream->Write(response)) break;
+        ++routed;
     }
-    std::cout << std::endl;
 
+    LOG_INFO("Server", "SubmitTasks stream from ", requester.server_id(), " closed after ", routed, " tasks");
     return grpc::Status::OK;
 }
 
 grpc::Status TARServiceImpl::AcknowledgeTask(grpc::ServerContext*,
                                              const tar::TaskAck* request,
                                              tar::TaskAck* response) {
+    ScopedLatency latency(GetServerStats().acknowledge_task);
     if (!request) {
 return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Null request");
 }
 
     // Log the acknowledgment details
-    std::cout << "[Server] Received AcknowledgeTask request:" << std::endl;
-    std::cout << "  Task ID: " << request->task_id() << std::endl;
-    std::cout << "  From Server: " << request->server_id() << std::endl;
+    LOG_DEBUG("Server", "Received AcknowledgeTask request: task=", request->task_id(), " from=", request->server_id());
 
     bool success = algorithm_.acknowledgeTask(*request);
     response->CopyFrom(*request);
     response->set_success(success);
 
     // Log the acknowledgment result
-    std::cout << "[Server] AcknowledgeTask result: " << (success ? "Success" : "Failure") << std::endl;
+    LOG_DEBUG("Server", "AcknowledgeTask result: ", (success ? "Success" : "Failure"));
+
+    return grpc::Status::OK;
+}
+
+grpc::Status TARServiceImpl::ReplicateTasks(grpc::ServerContext*,
+                                            const tar::TaskBatch* request,
+                                            tar::TaskAckBatch* response) {
+    if (!request) {
+return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Null request");
+}
+
+    LOG_DEBUG("Server", "Received ", request->tasks_size(), " replicas");
+
+    const std::string& server_id = algorithm_.getServerId();
+    response->mutable_acks()->Reserve(request->tasks_size());
+    for (const auto& task : request->tasks()) {
+        algorithm_.holdReplica(task); // Runs here only if this server is its executor
+
+        auto* ack = response->add_acks();
+        ack->set_task_id(task.id());
+        ack->set_server_id(server_id);
+        ack->set_success(true);
+    }
+    algorithm_.waitForDurability(); // Ack replicas only once they would survive a crash
 
     return grpc::Status::OK;
 }
@@ -56,21 +223,39 @@ return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Null request");
 grpc::Status TARServiceImpl::Heartbeat(grpc::ServerContext*,
                                        const tar::ServerMetrics* request,
                                        tar::ServerMetrics* response) {
+    ScopedLatency latency(GetServerStats().heartbeat);
     if (!request) {
 return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Null request");
 }
 
     // Log the heartbeat details
-    std::cout << "[Server] Received Heartbeat from: " << request->server_id() << std::endl;
-    std::cout << "  CPU Utilization: " << request->cpu_utilization() << std::endl;
-    std::cout << "  Queue Length: " << request->queue_length() << std::endl;
-    std::cout << "  Last Heartbeat: " << request->last_heartbeat() << std::endl;
+    LOG_DEBUG("Server", "Received Heartbeat from: ", request->server_id(),
+              " cpu=", request->cpu_utilization(), " queue_length=", request->queue_length(),
+              " last_heartbeat=", request->last_heartbeat());
 
-    algorithm_.updateServerMetrics(*request);
-    response->CopyFrom(*request);
+    algorithm_.updateServerMetrics(*request, TARAlgorithm::MetricsSource::kHeartbeatRequest);
+
+    // Reply with our own metrics so the sender learns about this server
+    *response = algorithm_.getLocalMetrics();
+
+    return grpc::Status::OK;
+}
+
+grpc::Status TARServiceImpl::Gossip(grpc::ServerContext*,
+                                    const tar::GossipMessage* request,
+                                    tar::GossipMessage* response) {
+    if (!request) {
+return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Null request");
+}
+
+    std::vector<tar::ServerMetrics> learned;
+    *response = gossip_.handle(*request, learned);
+    for (const auto& metrics : learned) {
+        algorithm_.updateServerMetrics(metrics, TARAlgorithm::MetricsSource::kGossip);
+    }
 
-    // Log the updated metrics
-    std::cout << "[Server] Updated metrics for: " << request->server_id() << std::endl;
+    LOG_DEBUG("Gossip", "Round from ", request->sender_id(), ": ", request->updates_size(),
+              " updates in, ", response->updates_size(), " out");
 
     return grpc::Status::OK;
 }
@@ -78,32 +263,64 @@ return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Null request");
 grpc::Status TARServiceImpl::RequestTaskTransfer(grpc::ServerContext*,
                                                  const tar::ServerMetrics* request,
                                                  tar::Task* response) {
+    ScopedLatency latency(GetServerStats().request_task_transfer);
     if (!request) {
 return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Null request");
 }
 
     // Log the task transfer request
-    std::cout << "[Server] Received RequestTaskTransfer from: " << request->server_id() << std::endl;
+    LOG_DEBUG("Server", "Received RequestTaskTransfer from: ", request->server_id());
 
     auto task_opt = algorithm_.requestTaskTransfer(*request);
     if (!task_opt.has_value()) {
-std::cout << "[Server] No task available for transfer to: " << request->server_id() << std::endl;
+LOG_INFO("Server", "No task available for transfer to: ", request->server_id());
         return grpc::Status(grpc::StatusCode::NOT_FOUND, "No task available");
     }
 
-    response->CopyFrom(task_opt.value());
+    *response = std::move(*task_opt); // The task left our queue, so hand it over without a copy
 
     // Log the task transfer details
-    std::cout << "[Server] Task transferred to: " << request->server_id() << std::endl;
-    std::cout << "  Task ID: " << response->id() << std::endl;
+    LOG_INFO("Server", "Task ", response->id(), " transferred to: ", request->server_id());
+
+    return grpc::Status::OK;
+}
+
+grpc::Status TARServiceImpl::StealTasks(grpc::ServerContext*,
+                                        const tar::StealRequest* request,
+                                        tar::TaskBatch* response) {
+    if (!request) {
+return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Null request");
+}
+
+    LOG_DEBUG("Server", "Received StealTasks from: ", request->thief_metrics().server_id(),
+              " (up to ", request->max_tasks(), " tasks)");
+
+    auto tasks = algorithm_.stealTasks(request->thief_metrics(), request->max_tasks());
+    response->mutable_tasks()->Reserve(tasks.size());
+    for (auto& task : tasks) {
+        *response->add_tasks() = std::move(task);
+    }
+
+    LOG_INFO("Server", "Transferred ", tasks.size(), " tasks to: ", request->thief_metrics().server_id());
 
     return grpc::Status::OK;
 }
 
-void TARServiceImpl::addTaskToQueue(const tar::Task& task) {
-    algorithm_.addTaskToQueue(task);
+grpc::Status TARServiceImpl::GetStats(grpc::ServerContext*,
+                                      const tar::StatsRequest*,
+                                      tar::StatsResponse* response) {
+    std::array<size_t, tar::Priority_ARRAYSIZE> queue_depth{};
+    for (int priority = 0; priority < tar::Priority_ARRAYSIZE; ++priority) {
+        queue_depth[priority] = algorithm_.getTaskQueueLength(static_cast<tar::Priority>(priority));
+    }
+    response->set_prometheus_text(GetServerStats().renderPrometheus(queue_depth));
+    return grpc::Status::OK;
+}
+
+void TARServiceImpl::addTaskToQueue(tar::Task task) {
+    algorithm_.addTaskToQueue(std::move(task));
 }
 
-void TARServiceImpl::updateServerMetrics(const tar::ServerMetrics& metrics) {
-    algorithm_.updateServerMetrics(metrics);
+void TARServiceImpl::updateServerMetrics(const tar::ServerMetrics& metrics, TARAlgorithm::MetricsSource source) {
+    algorithm_.updateServerMetrics(metrics, source);
 }
@@ -1,42 +1,80 @@
 #pragma once
 
 #include "TARAlgorithm.hpp"
+#include "PeerConnectionManager.hpp"
+#include "ReplicationDispatcher.hpp"
+#include "MetricsGossip.hpp"
 #include "tar.grpc.pb.h"
 #include <grpcpp/grpcpp.h>
 #include <memory>
 
 class TARServiceImpl final : public tar::TARService::Service {
 public:
-    TARServiceImpl(const std::string& server_id, const std::vector<std::string>& peers);
+    // Replicas are only dispatched when peer_connections is provided
+    TARServiceImpl(const std::string& server_id, const std::vector<std::string>& peers,
+                   PeerConnectionManager* peer_connections = nullptr);
 
     grpc::Status RouteTask(grpc::ServerContext*,
                            const tar::RouteTaskRequest* request,
                            tar::RouteTaskResponse* response) override;
 
+    grpc::Status RouteTaskBatch(grpc::ServerContext*,
+                                const tar::RouteTaskBatchRequest* request,
+                                tar::RouteTaskBatchResponse* response) override;
+
+    grpc::Status SubmitTasks(grpc::ServerContext* context,
+                             grpc::ServerReaderWriter<tar::RouteTaskResponse, tar::Task>* stream) override;
+
     grpc::Status AcknowledgeTask(grpc::ServerContext*,
                                  const tar::TaskAck* request,
                                  tar::TaskAck* response) override;
 
+    grpc::Status ReplicateTasks(grpc::ServerContext*,
+                                const tar::TaskBatch* request,
+                                tar::TaskAckBatch* response) override;
+
+    grpc::Status GetStats(grpc::ServerContext*,
+                          const tar::StatsRequest* request,
+                          tar::StatsResponse* response) override;
+
     grpc::Status Heartbeat(grpc::ServerContext*,
                            const tar::ServerMetrics* request,
                            tar::ServerMetrics* response) override;
 
+    grpc::Status Gossip(grpc::ServerContext*,
+                        const tar::GossipMessage* request,
+                        tar::GossipMessage* response) override;
+
     grpc::Status RequestTaskTransfer(grpc::ServerContext*,
                                      const tar::ServerMetrics* request,
                                      tar::Task* response) override;
 
+    grpc::Status StealTasks(grpc::ServerContext*,
+                            const tar::StealRequest* request,
+                            tar::TaskBatch* response) override;
+
     // New method to get task queue length
     int getTaskQueueLength() const {
         return algorithm_.getTaskQueueLength();
     }
 
-    void addTaskToQueue(const tar::Task& task);
+    void addTaskToQueue(tar::Task task);
 
     // Add this method to update server metrics
-    void updateServerMetrics(const tar::ServerMetrics& metrics);
+    void updateServerMetrics(const tar::ServerMetrics& metrics, TARAlgorithm::MetricsSource source);
 
     TARAlgorithm& getAlgorithm() { return algorithm_; } // Expose algorithm
+    MetricsGossip& getGossip() { return gossip_; }
 
 private:
+    // Copy an incoming task once into a shared message owned by this server
+    std::shared_ptr<tar::Task> adoptTask(const tar::Task& task) const;
+
+    // Send replicas and wait for the quorum; fails if it was not reached or the
+    // task id is still replicating from an earlier submission
+    grpc::Status replicateAndCommit(std::shared_ptr<tar::Task> task, const std::vector<std::string>& targets);
+
     TARAlgorithm algorithm_;
+    MetricsGossip gossip_;
+    std::unique_ptr<ReplicationDispatcher> replicator_;
 };
@@ -0,0 +1,175 @@
+#include "TaskExecutor.hpp"
+#include "EnvConfig.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+bool TaskExecutor::SyntheticHandler(const tar::Task& task) {
+    const std::string& payload = task.payload();
+    auto work_ms = [&](size_t prefix_length) {
+        return std::chrono::milliseconds(std::atoi(payload.c_str() + prefix_length));
+    };
+
+    if (payload.compare(0, 4, "cpu:") == 0) {
+        auto until = std::chrono::steady_clock::now() + work_ms(4);
+        volatile uint64_t spin = 0;
+        while (std::chrono::steady_clock::now() < until) {
+            for (int i = 0; i < 1000; ++i) spin = spin + i;
+        }
+    } else if (payload.compare(0, 6, "sleep:") == 0) {
+        std::this_thread::sleep_for(work_ms(6));
+    }
+    return true;
+}
+
+TaskExecutor::TaskExecutor(TARAlgorithm* algorithm, PeerConnectionManager* peer_connections,
+                           TaskHandler handler, int num_workers, int prefetch)
+    : algorithm_(algorithm),
+      peer_connections_(peer_connections),
+      handler_(std::move(handler)),
+      prefetch_(std::max(1, prefetch)),
+      ack_deadline_ms_(GetEnvOrDefault("EXECUTOR_ACK_DEADLINE_MS", 1000)),
+      max_idle_wait_(GetEnvOrDefault("EXECUTOR_IDLE_MAX_MS", 10)) {
+    for (int i = 0; i < std::max(1, num_workers); ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+}
+
+TaskExecutor::~TaskExecutor() {
+    stop();
+}
+
+void TaskExecutor::start() {
+    algorithm_->setExecutorWorkers(static_cast<int>(workers_.size()));
+    ack_thread_ = std::thread(&TaskExecutor::ackCompletionLoop, this);
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        threads_.emplace_back(&TaskExecutor::run, this, i);
+    }
+    LOG_INFO("Executor", "Running ", workers_.size(), " workers (prefetch ", prefetch_, ")");
+}
+
+void TaskExecutor::stop() {
+    if (stopping_.exchange(true)) return;
+
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+
+    // Prefetched tasks that never ran go back to the queue
+    for (auto& worker : workers_) {
+        for (auto& task : worker->tasks) {
+            algorithm_->addTaskToQueue(std::move(task));
+            pending_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        worker->tasks.clear();
+    }
+
+    ack_cq_.Shutdown();
+    if (ack_thread_.joinable()) ack_thread_.join();
+}
+
+std::optional<tar::Task> TaskExecutor::nextTask(size_t index) {
+    Worker& self = *workers_[index];
+    {
+        std::lock_guard<std::mutex> lock(self.mutex);
+        if (self.tasks.empty()) {
+            // Refill from the shared queue, most urgent first
+            while (self.tasks.size() < prefetch_) {
+                auto task = algorithm_->popTask();
+                if (!task) break;
+                self.tasks.push_back(std::move(*task));
+                pending_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        if (!self.tasks.empty()) {
+            tar::Task task = std::move(self.tasks.front());
+            self.tasks.pop_front();
+            return task;
+        }
+    }
+
+    // Nothing queued: take the least urgent prefetched task of another worker
+    for (size_t i = 1; i < workers_.size(); ++i) {
+        Worker& victim = *workers_[(index + i) % workers_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            tar::Task task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            return task;
+        }
+    }
+    return std::nullopt;
+}
+
+void TaskExecutor::run(size_t index) {
+    auto idle_wait = std::chrono::milliseconds(1);
+
+    while (!stopping_) {
+        auto task = nextTask(index);
+        if (!task) {
+            std::this_thread::sleep_for(idle_wait);
+            idle_wait = std::min(idle_wait * 2, max_idle_wait_);
+            continue;
+        }
+        idle_wait = std::chrono::milliseconds(1);
+
+        auto started = std::chrono::steady_clock::now();
+        bool success = handler_(*task);
+        algorithm_->completeTask(task->id(), std::chrono::steady_clock::now() - started);
+        acknowledge(*task, success);
+        pending_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void TaskExecutor::acknowledge(const tar::Task& task, bool success) {
+    // The coordinator and every other target hold a standby copy to release
+    const std::string& self_id = algorithm_->getServerId();
+    std::vector<const std::string*> holders;
+    auto add_holder = [&](const std::string& server) {
+        if (server.empty() || server == self_id) return;
+        for (const auto* holder : holders) {
+            if (*holder == server) return;
+        }
+        holders.push_back(&server);
+    };
+    add_holder(task.coordinator_id());
+    for (const auto& target : task.targets()) add_holder(target);
+
+    if (holders.empty()) {
+        LOG_DEBUG("Executor", "Completed task ", task.id(), (success ? "" : " (failed)"));
+        return; // Ran on the server that routed it, with no replicas to release
+    }
+
+    for (const auto* holder : holders) {
+        auto* stub = peer_connections_->getStubForServer(*holder);
+        if (!stub) {
+            LOG_WARN("Executor", "No connection to ", *holder, " to acknowledge task ", task.id());
+            continue;
+        }
+
+        // Owned by the completion queue until ackCompletionLoop picks it up
+        auto* call = new AsyncAckCall;
+        call->holder = *holder;
+        call->request.set_task_id(task.id());
+        call->request.set_server_id(self_id);
+        call->request.set_success(success);
+        call->context.set_deadline(std::chrono::system_clock::now() + std::chrono::milliseconds(ack_deadline_ms_));
+        call->reader = stub->PrepareAsyncAcknowledgeTask(&call->context, call->request, &ack_cq_);
+        call->reader->StartCall();
+        call->reader->Finish(&call->response, &call->status, call);
+    }
+}
+
+void TaskExecutor::ackCompletionLoop() {
+    void* tag;
+    bool ok;
+    while (ack_cq_.Next(&tag, &ok)) {
+        std::unique_ptr<AsyncAckCall> call(static_cast<AsyncAckCall*>(tag));
+        if (!call->status.ok()) {
+            LOG_WARN("Executor", "Failed to acknowledge task ", call->request.task_id(), " to ",
+                     call->holder, ": ", call->status.error_message());
+        }
+    }
+}
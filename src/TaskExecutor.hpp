@@ -0,0 +1,76 @@
+#pragma once
+
+#include "TARAlgorithm.hpp"
+#include "PeerConnectionManager.hpp"
+#include "tar.grpc.pb.h"
+#include <grpcpp/grpcpp.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Runs queued tasks on a pool of worker threads. Each worker prefetches a few
+// tasks from the task queue (in priority order) into its own deque, works from
+// the front of it, and steals from the back of another worker's deque when both
+// its deque and the queue are empty. Completed tasks are acknowledged to the
+// server that coordinated them and to their other targets, which then drop
+// their standby copies.
+class TaskExecutor {
+public:
+    // Runs one task; returns false if it failed
+    using TaskHandler = std::function<bool(const tar::Task&)>;
+
+    // Built-in handler for testing: a payload of "cpu:<ms>" busy-spins and
+    // "sleep:<ms>" sleeps for that long; any other payload completes at once
+    static bool SyntheticHandler(const tar::Task& task);
+
+    TaskExecutor(TARAlgorithm* algorithm, PeerConnectionManager* peer_connections,
+                 TaskHandler handler, int num_workers, int prefetch);
+    ~TaskExecutor();
+
+    void start();
+    void stop();
+
+    // Tasks taken off the queue but not finished yet
+    size_t pending() const { return pending_.load(std::memory_order_relaxed); }
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<tar::Task> tasks;
+    };
+
+    struct AsyncAckCall {
+        std::string holder;
+        grpc::ClientContext context;
+        tar::TaskAck request;
+        tar::TaskAck response;
+        grpc::Status status;
+        std::unique_ptr<grpc::ClientAsyncResponseReader<tar::TaskAck>> reader;
+    };
+
+    void run(size_t index);
+    std::optional<tar::Task> nextTask(size_t index);
+    void acknowledge(const tar::Task& task, bool success);
+    void ackCompletionLoop();
+
+    TARAlgorithm* algorithm_;
+    PeerConnectionManager* peer_connections_;
+    TaskHandler handler_;
+    size_t prefetch_;
+    int ack_deadline_ms_;
+    std::chrono::milliseconds max_idle_wait_;
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<size_t> pending_{0};
+
+    grpc::CompletionQueue ack_cq_;
+    std::thread ack_thread_;
+};
@@ -0,0 +1,378 @@
+#include "TaskLog.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <libgen.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kMagic[8] = {'T', 'A', 'R', 'L', 'O', 'G', '0', '1'};
+constexpr size_t kFileHeaderSize = 16;
+constexpr size_t kRecordHeaderSize = 16;
+constexpr uint32_t kAddRecord = 1;
+constexpr uint32_t kRemoveRecord = 2;
+
+// On-disk record header; the id and, for adds, the serialized task follow it.
+// Records are padded to 8 bytes.
+struct RecordHeader {
+    uint32_t checksum; // Over the rest of the header and the payload
+    uint32_t type;
+    uint32_t id_length;
+    uint32_t payload_length; // Id plus task bytes
+};
+static_assert(sizeof(RecordHeader) == kRecordHeaderSize, "record header layout");
+
+size_t RecordLength(size_t payload_length) {
+    return (kRecordHeaderSize + payload_length + 7) & ~size_t{7};
+}
+
+uint32_t Checksum(const char* data, size_t length, uint32_t hash = 2166136261u) {
+    // FNV-1a: enough to reject a torn or never-written record at the tail
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+uint32_t RecordChecksum(const char* record, size_t payload_length) {
+    return Checksum(record + sizeof(uint32_t), kRecordHeaderSize - sizeof(uint32_t) + payload_length);
+}
+
+size_t PageSize() {
+    static const size_t page_size = sysconf(_SC_PAGESIZE);
+    return page_size;
+}
+
+char* MapFile(int fd, size_t length) {
+    void* base = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return base == MAP_FAILED ? nullptr : static_cast<char*>(base);
+}
+
+// Make a rename in dir durable
+void SyncDirectory(const std::string& path) {
+    std::string copy = path;
+    int dir_fd = ::open(dirname(copy.data()), O_RDONLY | O_DIRECTORY);
+    if (dir_fd < 0) return;
+    fsync(dir_fd);
+    close(dir_fd);
+}
+
+} // namespace
+
+std::unique_ptr<TaskLog> TaskLog::open(const std::string& path, const Options& options,
+                                       std::vector<tar::Task>* recovered) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("Task Log", "Cannot open ", path, ": ", std::strerror(errno));
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return nullptr;
+    }
+    size_t capacity = std::max<size_t>(st.st_size, std::max(options.initial_size, PageSize()));
+    if (static_cast<size_t>(st.st_size) < capacity && ftruncate(fd, capacity) != 0) {
+        LOG_ERROR("Task Log", "Cannot size ", path, ": ", std::strerror(errno));
+        close(fd);
+        return nullptr;
+    }
+
+    char* base = MapFile(fd, capacity);
+    if (!base) {
+        LOG_ERROR("Task Log", "Cannot map ", path, ": ", std::strerror(errno));
+        close(fd);
+        return nullptr;
+    }
+
+    if (st.st_size == 0) {
+        std::memcpy(base, kMagic, sizeof(kMagic));
+    } else if (std::memcmp(base, kMagic, sizeof(kMagic)) != 0) {
+        LOG_ERROR("Task Log", path, " is not a task log");
+        munmap(base, capacity);
+        close(fd);
+        return nullptr;
+    }
+
+    std::unique_ptr<TaskLog> log(new TaskLog(path, options, fd, base, capacity));
+    if (!log->recover(recovered)) return nullptr;
+    log->sync_thread_ = std::thread(&TaskLog::syncLoop, log.get());
+    return log;
+}
+
+TaskLog::TaskLog(std::string path, const Options& options, int fd, char* base, size_t capacity)
+    : path_(std::move(path)), options_(options), fd_(fd), base_(base), capacity_(capacity),
+      tail_(kFileHeaderSize), synced_(kFileHeaderSize) {}
+
+TaskLog::~TaskLog() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    flush_cv_.notify_one();
+    if (sync_thread_.joinable()) sync_thread_.join(); // Syncs whatever is left first
+
+    munmap(base_, capacity_);
+    close(fd_);
+}
+
+bool TaskLog::recover(std::vector<tar::Task>* recovered) {
+    // Pass 1: walk the headers and keep the latest add of every id that was
+    // never removed. Only ids are read here; tasks are parsed in pass 2.
+    size_t offset = kFileHeaderSize;
+    while (offset + kRecordHeaderSize <= capacity_) {
+        RecordHeader header;
+        std::memcpy(&header, base_ + offset, sizeof(header));
+        if (header.type != kAddRecord && header.type != kRemoveRecord) break;
+        if (header.id_length > header.payload_length) break;
+        size_t length = RecordLength(header.payload_length);
+        if (length > capacity_ - offset) break;
+        if (RecordChecksum(base_ + offset, header.payload_length) != header.checksum) break; // Torn write
+
+        std::string id(base_ + offset + kRecordHeaderSize, header.id_length);
+        if (header.type == kAddRecord) {
+            auto [it, inserted] = live_.try_emplace(std::move(id), Location{offset, length});
+            if (!inserted) {
+                live_bytes_ -= it->second.length;
+                it->second = Location{offset, length};
+            }
+            live_bytes_ += length;
+        } else {
+            auto it = live_.find(id);
+            if (it != live_.end()) {
+                live_bytes_ -= it->second.length;
+                live_.erase(it);
+            }
+        }
+        offset += length;
+    }
+    tail_ = synced_ = offset;
+
+    // Whatever follows the last valid record is garbage from a crash; clear it
+    // so records appended from now on can never run into stale ones
+    size_t clear_from = (tail_ + PageSize() - 1) & ~(PageSize() - 1);
+    std::memset(base_ + tail_, 0, std::min(clear_from, capacity_) - tail_);
+    if (clear_from < capacity_) {
+#ifdef FALLOC_FL_PUNCH_HOLE
+        // Dropping the blocks is O(extents), unlike zeroing them
+        if (fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, clear_from, capacity_ - clear_from) != 0)
+#endif
+            std::memset(base_ + clear_from, 0, capacity_ - clear_from);
+    }
+    if (msync(base_, capacity_, MS_SYNC) != 0) {
+        LOG_ERROR("Task Log", "Cannot sync ", path_, ": ", std::strerror(errno));
+        return false;
+    }
+
+    // Pass 2: parse only the live tasks, in log order
+    std::vector<const Location*> live;
+    live.reserve(live_.size());
+    for (const auto& entry : live_) live.push_back(&entry.second);
+    std::sort(live.begin(), live.end(), [](const Location* a, const Location* b) { return a->offset < b->offset; });
+
+    recovered->reserve(recovered->size() + live.size());
+    for (const Location* location : live) {
+        RecordHeader header;
+        std::memcpy(&header, base_ + location->offset, sizeof(header));
+        const char* body = base_ + location->offset + kRecordHeaderSize + header.id_length;
+        tar::Task task;
+        if (task.ParseFromArray(body, header.payload_length - header.id_length)) {
+            recovered->push_back(std::move(task));
+        }
+    }
+    return true;
+}
+
+void TaskLog::reserveLocked(std::unique_lock<std::mutex>& lock, size_t length) {
+    while (tail_ + length > capacity_) {
+        // Remapping must not pull the mapping out from under an msync
+        durable_cv_.wait(lock, [this] { return !syncing_; });
+        if (tail_ + length <= capacity_) break;
+
+        size_t capacity = capacity_;
+        while (tail_ + length > capacity) capacity *= 2;
+        char* base = nullptr;
+        if (ftruncate(fd_, capacity) == 0) base = MapFile(fd_, capacity);
+        if (!base) {
+            // Nothing sensible to do with a full disk but stop and say so
+            LOG_ERROR("Task Log", "Cannot grow ", path_, " to ", capacity, " bytes: ", std::strerror(errno));
+            Logger::instance().flush();
+            std::abort();
+        }
+        // Dirty pages of the old mapping stay in the page cache; the next
+        // sync writes them through the new one
+        munmap(base_, capacity_);
+        base_ = base;
+        capacity_ = capacity;
+        size_changed_ = true;
+    }
+}
+
+void TaskLog::writeRecordLocked(uint32_t type, const std::string& task_id, const tar::Task* task, size_t length) {
+    char* record = base_ + tail_;
+    size_t body_length = task ? task->GetCachedSize() : 0;
+    RecordHeader header{0, type, static_cast<uint32_t>(task_id.size()),
+                        static_cast<uint32_t>(task_id.size() + body_length)};
+
+    std::memcpy(record + sizeof(header), task_id.data(), task_id.size());
+    if (task) {
+        task->SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(record + sizeof(header) + task_id.size()));
+    }
+    std::memcpy(record, &header, sizeof(header));
+    header.checksum = RecordChecksum(record, header.payload_length);
+    std::memcpy(record, &header.checksum, sizeof(header.checksum));
+
+    bool was_clean = tail_ == synced_;
+    tail_ += length;
+    appended_lsn_ += length;
+    if (was_clean) flush_cv_.notify_one();
+}
+
+void TaskLog::append(const tar::Task& task) {
+    size_t length = RecordLength(task.id().size() + task.ByteSizeLong());
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    reserveLocked(lock, length);
+
+    auto [it, inserted] = live_.try_emplace(task.id(), Location{tail_, length});
+    if (!inserted) {
+        live_bytes_ -= it->second.length;
+        it->second = Location{tail_, length};
+    }
+    live_bytes_ += length;
+    writeRecordLocked(kAddRecord, task.id(), &task, length);
+}
+
+void TaskLog::remove(const std::string& task_id) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = live_.find(task_id);
+    if (it == live_.end()) return;
+    live_bytes_ -= it->second.length;
+    live_.erase(it);
+
+    size_t length = RecordLength(task_id.size());
+    reserveLocked(lock, length);
+    writeRecordLocked(kRemoveRecord, task_id, nullptr, length);
+}
+
+void TaskLog::waitDurable() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t target = appended_lsn_;
+    durable_cv_.wait(lock, [&] { return durable_lsn_ >= target || stopping_; });
+}
+
+size_t TaskLog::liveTasks() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return live_.size();
+}
+
+void TaskLog::syncLocked(std::unique_lock<std::mutex>& lock) {
+    size_t from = synced_ & ~(PageSize() - 1);
+    size_t to = tail_;
+    uint64_t lsn = appended_lsn_;
+    bool size_changed = size_changed_;
+    size_changed_ = false;
+    syncing_ = true;
+
+    lock.unlock();
+    int result = msync(base_ + from, to - from, MS_SYNC);
+    if (result == 0 && size_changed) result = fsync(fd_); // Also persists the new file size
+    lock.lock();
+
+    syncing_ = false;
+    if (result != 0) {
+        LOG_ERROR("Task Log", "Sync of ", path_, " failed: ", std::strerror(errno));
+        size_changed_ |= size_changed; // Retried on the next round
+    } else {
+        synced_ = std::max(synced_, to);
+        durable_lsn_ = std::max(durable_lsn_, lsn);
+    }
+    durable_cv_.notify_all();
+}
+
+bool TaskLog::compactionDueLocked() const {
+    return tail_ >= options_.compact_min_size && live_bytes_ * 2 < tail_ - kFileHeaderSize;
+}
+
+void TaskLog::compactLocked() {
+    // Appends wait while live records are copied; the copy is a memcpy per
+    // record, so this takes about as long as writing the live tasks once
+    std::string compact_path = path_ + ".compact";
+    size_t capacity = std::max(options_.initial_size, kFileHeaderSize + live_bytes_ * 2);
+    capacity = (capacity + PageSize() - 1) & ~(PageSize() - 1);
+
+    int fd = ::open(compact_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    char* base = nullptr;
+    if (fd >= 0 && ftruncate(fd, capacity) == 0) base = MapFile(fd, capacity);
+    if (!base) {
+        LOG_WARN("Task Log", "Compaction of ", path_, " skipped: ", std::strerror(errno));
+        if (fd >= 0) close(fd);
+        return;
+    }
+
+    std::vector<Location*> live;
+    live.reserve(live_.size());
+    for (auto& entry : live_) live.push_back(&entry.second);
+    std::sort(live.begin(), live.end(), [](const Location* a, const Location* b) { return a->offset < b->offset; });
+
+    std::memcpy(base, kMagic, sizeof(kMagic));
+    std::vector<size_t> offsets;
+    offsets.reserve(live.size());
+    size_t tail = kFileHeaderSize;
+    for (const Location* location : live) {
+        std::memcpy(base + tail, base_ + location->offset, location->length);
+        offsets.push_back(tail);
+        tail += location->length;
+    }
+
+    if (msync(base, tail, MS_SYNC) != 0 || fsync(fd) != 0 || rename(compact_path.c_str(), path_.c_str()) != 0) {
+        // The old log is untouched, so keep using it
+        LOG_WARN("Task Log", "Compaction of ", path_, " failed: ", std::strerror(errno));
+        munmap(base, capacity);
+        close(fd);
+        unlink(compact_path.c_str());
+        return;
+    }
+    SyncDirectory(path_);
+    for (size_t i = 0; i < live.size(); ++i) {
+        live[i]->offset = offsets[i];
+    }
+
+    LOG_INFO("Task Log", "Compacted ", path_, " from ", tail_, " to ", tail, " bytes (", live_.size(), " live tasks)");
+    munmap(base_, capacity_);
+    close(fd_);
+    fd_ = fd;
+    base_ = base;
+    capacity_ = capacity;
+    tail_ = synced_ = tail;
+    durable_lsn_ = appended_lsn_; // Everything live is in the synced file
+    durable_cv_.notify_all();
+}
+
+void TaskLog::syncLoop() {
+    auto last_sync = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        flush_cv_.wait(lock, [this] { return stopping_ || tail_ > synced_; });
+        if (tail_ == synced_) break; // Stopping with nothing left to write
+
+        // Let a window's worth of appends gather so they share one sync
+        if (!stopping_) {
+            lock.unlock();
+            std::this_thread::sleep_until(last_sync + options_.sync_window);
+            lock.lock();
+        }
+        syncLocked(lock);
+        last_sync = std::chrono::steady_clock::now();
+
+        if (compactionDueLocked()) compactLocked();
+    }
+}
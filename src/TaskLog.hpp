@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "tar.pb.h"
+
+// Append-only log of the local task queue, memory-mapped so appending a task
+// is a copy into the page cache rather than a write syscall. A background
+// thread makes the log durable with group commit: one msync per sync window
+// covers every record appended since the last one, and callers that need a
+// task on disk before answering block in waitDurable() until their batch is
+// synced.
+//
+// Each record is an add (task id + serialized task) or a remove (task id).
+// Once removed records make up more than half the log, it is compacted by
+// copying the live records into a fresh file that atomically replaces the old
+// one, so the log stays within about twice the size of the live tasks and
+// recovery time follows the number of queued tasks rather than history.
+class TaskLog {
+public:
+    struct Options {
+        std::chrono::milliseconds sync_window{2};
+        size_t initial_size = 64u << 20;     // Bytes mapped up front; doubled when full
+        size_t compact_min_size = 64u << 20; // Logs smaller than this are never compacted
+    };
+
+    // Opens or creates the log and appends the tasks still live in it to
+    // recovered, in the order they were logged. Returns nullptr on I/O errors.
+    static std::unique_ptr<TaskLog> open(const std::string& path, const Options& options,
+                                         std::vector<tar::Task>* recovered);
+    ~TaskLog();
+
+    TaskLog(const TaskLog&) = delete;
+    TaskLog& operator=(const TaskLog&) = delete;
+
+    // Record that a task was queued (replacing any earlier record for its id)
+    void append(const tar::Task& task);
+
+    // Record that a task left the queue for good; no-op for unknown ids
+    void remove(const std::string& task_id);
+
+    // Block until every record appended before the call is on disk
+    void waitDurable();
+
+    size_t liveTasks() const;
+
+private:
+    struct Location {
+        size_t offset;
+        size_t length;
+    };
+
+    TaskLog(std::string path, const Options& options, int fd, char* base, size_t capacity);
+
+    bool recover(std::vector<tar::Task>* recovered);
+    void writeRecordLocked(uint32_t type, const std::string& task_id, const tar::Task* task, size_t length);
+    void reserveLocked(std::unique_lock<std::mutex>& lock, size_t length);
+    void syncLocked(std::unique_lock<std::mutex>& lock);
+    bool compactionDueLocked() const;
+    void compactLocked();
+    void syncLoop();
+
+    const std::string path_;
+    const Options options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable flush_cv_;   // Wakes the sync thread
+    std::condition_variable durable_cv_; // Signalled after every sync
+
+    int fd_;
+    char* base_;
+    size_t capacity_;
+    size_t tail_;              // End of the last record
+    size_t synced_;            // Offset up to which the mapping is on disk
+    bool size_changed_ = false; // File grew since the last sync
+    bool syncing_ = false;      // msync in progress on the current mapping
+
+    // Monotonic byte counts, unaffected by compaction
+    uint64_t appended_lsn_ = 0;
+    uint64_t durable_lsn_ = 0;
+
+    std::unordered_map<std::string, Location> live_;
+    size_t live_bytes_ = 0;
+
+    bool stopping_ = false;
+    std::thread sync_thread_; // Declared last so it starts after the state above
+};
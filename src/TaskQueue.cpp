@@ -0,0 +1,251 @@
+#include "TaskQueue.hpp"
+#include "Stats.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+TaskQueue::Shard& TaskQueue::shardFor(const std::string& task_id) {
+    return shards_[std::hash<std::string>{}(task_id) % kNumShards];
+}
+
+bool TaskQueue::isLive(const Shard& shard, const HeapEntry& entry) const {
+    auto it = shard.index.find(entry.id);
+    return it != shard.index.end() && it->second.seq == entry.seq;
+}
+
+const TaskQueue::HeapEntry* TaskQueue::peekLocked(Shard& shard, int priority) {
+    auto& heap = shard.heaps[priority];
+    while (!heap.empty() && !isLive(shard, heap.front())) {
+        std::pop_heap(heap.begin(), heap.end(), LaterFirst{});
+        heap.pop_back();
+    }
+    return heap.empty() ? nullptr : &heap.front();
+}
+
+tar::Task TaskQueue::takeOwnership(std::shared_ptr<tar::Task> task) {
+    if (task.use_count() == 1) {
+        // No replica RPC can still be reading it; pair with their release of the reference
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return std::move(*task);
+    }
+    return *task;
+}
+
+tar::Task TaskQueue::extractTopLocked(Shard& shard, int priority) {
+    auto& heap = shard.heaps[priority];
+    std::pop_heap(heap.begin(), heap.end(), LaterFirst{});
+    auto it = shard.index.find(heap.back().id);
+    heap.pop_back();
+    return detachLocked(shard, priority, it);
+}
+
+tar::Task TaskQueue::detachLocked(Shard& shard, int priority, IndexMap::iterator it) {
+    std::shared_ptr<tar::Task> task = std::move(it->second.task);
+    shard.index.erase(it);
+    shard.live[priority].fetch_sub(1, std::memory_order_relaxed);
+    level_sizes_[priority].fetch_sub(1, std::memory_order_relaxed);
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    compactLocked(shard, priority); // Its entry in the other heap is now stale
+    return takeOwnership(std::move(task));
+}
+
+void TaskQueue::compactLocked(Shard& shard, int priority) {
+    // Drop stale entries once they outnumber live ones, bounding heap growth
+    size_t live = shard.live[priority].load(std::memory_order_relaxed);
+    auto compact = [&](std::vector<HeapEntry>& heap, auto order) {
+        if (heap.size() < 64 || heap.size() < 2 * live) return;
+        heap.erase(std::remove_if(heap.begin(), heap.end(),
+                                  [&](const HeapEntry& entry) { return !isLive(shard, entry); }),
+                   heap.end());
+        std::make_heap(heap.begin(), heap.end(), order);
+    };
+    compact(shard.heaps[priority], LaterFirst{});
+    compact(shard.steal_heaps[priority], EarlierFirst{});
+}
+
+void TaskQueue::push(tar::Task task) {
+    push(std::make_shared<tar::Task>(std::move(task)));
+}
+
+void TaskQueue::push(std::shared_ptr<tar::Task> task) {
+    int priority = priorityIndex(task->priority());
+    int64_t deadline = task->deadline() > 0 ? task->deadline() : std::numeric_limits<int64_t>::max();
+    uint64_t seq = next_seq_.fetch_add(1, std::memory_order_relaxed);
+
+    Shard& shard = shardFor(task->id());
+    TimedLockGuard lock(shard.mutex, GetServerStats().queue_lock_wait);
+
+    auto it = shard.index.find(task->id());
+    if (it != shard.index.end()) {
+        // Replacing a queued task: its old heap entry goes stale
+        int old_priority = priorityIndex(it->second.task->priority());
+        shard.live[old_priority].fetch_sub(1, std::memory_order_relaxed);
+        level_sizes_[old_priority].fetch_sub(1, std::memory_order_relaxed);
+        it->second = IndexEntry{std::move(task), seq};
+        compactLocked(shard, old_priority);
+    } else {
+        std::string id = task->id(); // Copy before the task is moved into the entry
+        it = shard.index.emplace(std::move(id), IndexEntry{std::move(task), seq}).first;
+        size_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    auto& heap = shard.heaps[priority];
+    heap.push_back(HeapEntry{deadline, seq, it->first});
+    std::push_heap(heap.begin(), heap.end(), LaterFirst{});
+    auto& steal_heap = shard.steal_heaps[priority];
+    steal_heap.push_back(heap.back());
+    std::push_heap(steal_heap.begin(), steal_heap.end(), EarlierFirst{});
+    shard.live[priority].fetch_add(1, std::memory_order_relaxed);
+    level_sizes_[priority].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::optional<tar::Task> TaskQueue::pop() {
+    for (int priority = kNumPriorities - 1; priority >= 0; --priority) {
+        if (level_sizes_[priority].load(std::memory_order_relaxed) == 0) continue;
+
+        // Find the shard whose head has the nearest deadline at this priority
+        Shard* best = nullptr;
+        HeapEntry best_head{};
+        for (auto& shard : shards_) {
+            if (shard.live[priority].load(std::memory_order_relaxed) == 0) continue;
+
+            TimedLockGuard lock(shard.mutex, GetServerStats().queue_lock_wait);
+            const HeapEntry* head = peekLocked(shard, priority);
+            if (head && (!best || LaterFirst{}(best_head, *head))) {
+                best = &shard;
+                best_head = *head;
+            }
+        }
+        if (!best) continue;
+
+        TimedLockGuard lock(best->mutex, GetServerStats().queue_lock_wait);
+        if (peekLocked(*best, priority)) {
+            return extractTopLocked(*best, priority);
+        }
+    }
+
+    return std::nullopt;
+}
+
+std::optional<tar::Task> TaskQueue::takeTransferable(int max_hop_count) {
+    if (size() == 0) return std::nullopt;
+
+    // Start at a different shard each call so concurrent stealers spread out
+    size_t start = next_shard_.fetch_add(1, std::memory_order_relaxed);
+
+    for (int priority = kNumPriorities - 1; priority >= 0; --priority) {
+        if (level_sizes_[priority].load(std::memory_order_relaxed) == 0) continue;
+
+        for (size_t i = 0; i < kNumShards; ++i) {
+            Shard& shard = shards_[(start + i) % kNumShards];
+            if (shard.live[priority].load(std::memory_order_relaxed) == 0) continue;
+
+            TimedLockGuard lock(shard.mutex, GetServerStats().queue_lock_wait);
+            auto& heap = shard.heaps[priority];
+            std::vector<HeapEntry> skipped;
+            std::optional<tar::Task> found;
+
+            while (const HeapEntry* head = peekLocked(shard, priority)) {
+                const tar::Task& task = *shard.index.at(head->id).task;
+                if (task.hop_count() < max_hop_count) {
+                    found = extractTopLocked(shard, priority);
+                    break;
+                }
+
+                LOG_DEBUG("Task Transfer", "Task ", task.id(), " has reached max hop count. Skipping.");
+                GetServerStats().hop_rejections.fetch_add(1, std::memory_order_relaxed);
+                std::pop_heap(heap.begin(), heap.end(), LaterFirst{});
+                skipped.push_back(std::move(heap.back()));
+                heap.pop_back();
+            }
+
+            // Put the tasks that must stay here back in order
+            for (auto& entry : skipped) {
+                heap.push_back(std::move(entry));
+                std::push_heap(heap.begin(), heap.end(), LaterFirst{});
+            }
+
+            if (found) return found;
+        }
+    }
+
+    return std::nullopt;
+}
+
+void TaskQueue::takeLatestLocked(Shard& shard, int priority, int max_hop_count, size_t want,
+                                 std::vector<tar::Task>* taken) {
+    // The steal heap mirrors the deadline heap in reverse, so the least urgent
+    // entries come off its top; taking a task leaves its deadline heap entry stale
+    auto& heap = shard.steal_heaps[priority];
+    std::vector<HeapEntry> skipped;
+    while (want > 0 && !heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), EarlierFirst{});
+        HeapEntry entry = std::move(heap.back());
+        heap.pop_back();
+
+        auto it = shard.index.find(entry.id);
+        if (it == shard.index.end() || it->second.seq != entry.seq) continue; // Stale: dropped
+
+        if (it->second.task->hop_count() >= max_hop_count) {
+            LOG_DEBUG("Task Transfer", "Task ", entry.id, " has reached max hop count. Skipping.");
+            GetServerStats().hop_rejections.fetch_add(1, std::memory_order_relaxed);
+            skipped.push_back(std::move(entry));
+            continue;
+        }
+        taken->push_back(detachLocked(shard, priority, it));
+        --want;
+    }
+
+    // Put the tasks that must stay here back in order
+    for (auto& entry : skipped) {
+        heap.push_back(std::move(entry));
+        std::push_heap(heap.begin(), heap.end(), EarlierFirst{});
+    }
+}
+
+std::vector<tar::Task> TaskQueue::takeTransferableBatch(int max_hop_count, size_t max_tasks) {
+    std::vector<tar::Task> taken;
+    if (max_tasks == 0 || size() == 0) return taken;
+    taken.reserve(std::min(max_tasks, size()));
+
+    size_t start = next_shard_.fetch_add(1, std::memory_order_relaxed);
+
+    // Least urgent work goes first: the lowest priorities, and at each priority
+    // the latest deadlines. Each shard gives its share of what is still wanted,
+    // so the batch follows the level's overall deadline order rather than one
+    // shard's; another pass picks up what shards short of their share left over.
+    for (int priority = 0; priority < kNumPriorities && taken.size() < max_tasks; ++priority) {
+        if (level_sizes_[priority].load(std::memory_order_relaxed) == 0) continue;
+
+        for (size_t before = SIZE_MAX; taken.size() < max_tasks && taken.size() != before;) {
+            before = taken.size();
+            for (size_t i = 0; i < kNumShards && taken.size() < max_tasks; ++i) {
+                Shard& shard = shards_[(start + i) % kNumShards];
+                if (shard.live[priority].load(std::memory_order_relaxed) == 0) continue;
+
+                size_t share = (max_tasks - taken.size() + kNumShards - i - 1) / (kNumShards - i);
+                TimedLockGuard lock(shard.mutex, GetServerStats().queue_lock_wait);
+                takeLatestLocked(shard, priority, max_hop_count, share, &taken);
+            }
+        }
+    }
+
+    return taken;
+}
+
+bool TaskQueue::remove(const std::string& task_id) {
+    Shard& shard = shardFor(task_id);
+    TimedLockGuard lock(shard.mutex, GetServerStats().queue_lock_wait);
+
+    auto it = shard.index.find(task_id);
+    if (it == shard.index.end()) return false;
+
+    int priority = priorityIndex(it->second.task->priority());
+    shard.index.erase(it); // The heap entry is now stale and skipped on pop
+    shard.live[priority].fetch_sub(1, std::memory_order_relaxed);
+    level_sizes_[priority].fetch_sub(1, std::memory_order_relaxed);
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    compactLocked(shard, priority);
+    return true;
+}
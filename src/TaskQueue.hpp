@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "tar.pb.h"
+
+// Scheduling queue for tasks, split into independently locked shards (by task
+// id hash) so routing, heartbeats and stealing do not serialize on one mutex.
+//
+// Each shard keeps one min-heap per priority ordered by (deadline, arrival), so
+// takers always see the most urgent, nearest-deadline task first, a mirror
+// max-heap per priority that hands stealers the latest deadline first, and an
+// id index for O(1) lookup and removal. Removed, replaced or taken tasks leave
+// stale entries behind that are skipped (and periodically compacted), which
+// keeps URGENT pops independent of how large the LOW backlog grows.
+//
+// Tasks are held through shared pointers so in-flight replicas can borrow the
+// queued message instead of copying its payload. Queued tasks are never
+// mutated; takers move the task out when no replica still references it.
+class TaskQueue {
+public:
+    static constexpr size_t kNumShards = 16;
+    static constexpr int kNumPriorities = tar::Priority_ARRAYSIZE;
+
+    // Insert or replace a task
+    void push(tar::Task task);
+    void push(std::shared_ptr<tar::Task> task);
+
+    // Remove and return the most urgent task (highest priority, then nearest deadline)
+    std::optional<tar::Task> pop();
+
+    // Remove and return the most urgent task whose hop count is below max_hop_count
+    std::optional<tar::Task> takeTransferable(int max_hop_count);
+
+    // Remove up to max_tasks transferable tasks for a stealer: lowest priority
+    // first, then latest deadline (each shard gives its share, so the order
+    // holds per shard and approximately overall); O(log shard size) per task taken
+    std::vector<tar::Task> takeTransferableBatch(int max_hop_count, size_t max_tasks);
+
+    // Remove a task by id (e.g. once acknowledged); returns false if it was not queued
+    bool remove(const std::string& task_id);
+
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+    size_t size(tar::Priority priority) const {
+        return level_sizes_[priorityIndex(priority)].load(std::memory_order_relaxed);
+    }
+
+private:
+    struct HeapEntry {
+        int64_t deadline; // INT64_MAX when the task has no deadline
+        uint64_t seq;     // Arrival order; also identifies the live version of a task
+        std::string id;
+    };
+
+    // std::*_heap builds a max-heap, so invert the order to pop the earliest entry
+    struct LaterFirst {
+        bool operator()(const HeapEntry& a, const HeapEntry& b) const {
+            return a.deadline != b.deadline ? a.deadline > b.deadline : a.seq > b.seq;
+        }
+    };
+
+    // The reverse order, so the steal heaps put the latest entry on top
+    struct EarlierFirst {
+        bool operator()(const HeapEntry& a, const HeapEntry& b) const { return LaterFirst{}(b, a); }
+    };
+
+    struct IndexEntry {
+        std::shared_ptr<tar::Task> task;
+        uint64_t seq;
+    };
+
+    // Move the task out if we hold the last reference, otherwise copy it
+    static tar::Task takeOwnership(std::shared_ptr<tar::Task> task);
+
+    using IndexMap = std::unordered_map<std::string, IndexEntry>;
+
+    struct Shard {
+        std::mutex mutex;
+        IndexMap index;
+        std::array<std::vector<HeapEntry>, kNumPriorities> heaps;       // LaterFirst: earliest on top
+        std::array<std::vector<HeapEntry>, kNumPriorities> steal_heaps; // EarlierFirst: latest on top
+        std::array<std::atomic<size_t>, kNumPriorities> live{}; // Valid entries per heap
+    };
+
+    static int priorityIndex(int priority) {
+        return priority < 0 ? 0 : (priority >= kNumPriorities ? kNumPriorities - 1 : priority);
+    }
+
+    Shard& shardFor(const std::string& task_id);
+
+    // The helpers below require the shard mutex to be held
+    bool isLive(const Shard& shard, const HeapEntry& entry) const;
+    const HeapEntry* peekLocked(Shard& shard, int priority);
+    tar::Task extractTopLocked(Shard& shard, int priority);
+    tar::Task detachLocked(Shard& shard, int priority, IndexMap::iterator it);
+    void compactLocked(Shard& shard, int priority);
+    void takeLatestLocked(Shard& shard, int priority, int max_hop_count, size_t want, std::vector<tar::Task>* taken);
+
+    std::array<Shard, kNumShards> shards_;
+    std::atomic<size_t> size_{0};
+    std::array<std::atomic<size_t>, kNumPriorities> level_sizes_{};
+    std::atomic<uint64_t> next_seq_{0};
+    std::atomic<size_t> next_shard_{0}; // Rotates the starting shard for stealers
+};
@@ -0,0 +1,103 @@
+#include "TaskStealer.hpp"
+#include "EnvConfig.hpp"
+#include "Stats.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+
+TaskStealer::TaskStealer(PeerConnectionManager* peer_connections, TARServiceImpl* service)
+    : peer_connections_(peer_connections),
+      service_(service),
+      underloaded_threshold_(GetEnvOrDefault("UNDERLOADED_THRESHOLD", 2)),
+      overloaded_threshold_(GetEnvOrDefault("OVERLOADED_THRESHOLD", 10)),
+      max_steal_batch_(GetEnvOrDefault("STEAL_MAX_BATCH", 1000)),
+      rpc_deadline_ms_(GetEnvOrDefault("HEARTBEAT_DEADLINE_MS", 1000)),
+      check_interval_(GetEnvOrDefault("STEAL_CHECK_INTERVAL_MS", 100)) {}
+
+TaskStealer::~TaskStealer() {
+    stop();
+}
+
+void TaskStealer::start() {
+    thread_ = std::thread(&TaskStealer::run, this);
+}
+
+void TaskStealer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) thread_.join();
+}
+
+void TaskStealer::wake() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wake_requested_ = true;
+    }
+    cv_.notify_one();
+}
+
+void TaskStealer::run() {
+    // After a round that found nothing, wait for fresh peer metrics (the next
+    // wake) instead of asking the same peers again on every check
+    bool idle = false;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        cv_.wait_for(lock, check_interval_, [this] { return stopping_ || wake_requested_; });
+        if (stopping_) break;
+
+        bool woken = wake_requested_;
+        wake_requested_ = false;
+        if (woken) idle = false;
+        if (idle || service_->getTaskQueueLength() >= underloaded_threshold_) continue;
+
+        lock.unlock();
+        idle = stealRound() == 0;
+        lock.lock();
+    }
+}
+
+int TaskStealer::stealRound() {
+    TARAlgorithm& algorithm = service_->getAlgorithm();
+    int stolen = 0;
+
+    for (const auto& peer : algorithm.getOverloadedPeers(overloaded_threshold_)) {
+        tar::StealRequest request;
+        *request.mutable_thief_metrics() = algorithm.getLocalMetrics();
+        int local_length = request.thief_metrics().queue_length();
+        if (local_length >= underloaded_threshold_) break;
+
+        // Ask for half the imbalance; the victim applies the same cap on its side
+        request.set_max_tasks(std::min(max_steal_batch_, (peer.queue_length() - local_length) / 2));
+        if (request.max_tasks() <= 0) continue;
+
+        auto* stub = peer_connections_->getStubForServer(peer.server_id());
+        if (!stub) continue;
+
+        tar::TaskBatch batch;
+        grpc::ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::milliseconds(rpc_deadline_ms_));
+        grpc::Status status = stub->StealTasks(&context, request, &batch);
+
+        if (!status.ok()) {
+            LOG_WARN("Task Stealing", "Steal from ", peer.server_id(), " failed: ", status.error_message());
+            continue;
+        }
+        if (batch.tasks().empty()) {
+            LOG_DEBUG("Task Stealing", "No tasks available to steal from ", peer.server_id());
+            continue;
+        }
+
+        LOG_INFO("Task Stealing", "Stole ", batch.tasks_size(), " tasks from ", peer.server_id(),
+                 " (asked for ", request.max_tasks(), ")");
+        stolen += batch.tasks_size();
+        GetServerStats().tasks_stolen.fetch_add(batch.tasks_size(), std::memory_order_relaxed);
+        for (auto& task : *batch.mutable_tasks()) {
+            service_->addTaskToQueue(std::move(task)); // Hop count was already bumped by the victim
+        }
+    }
+
+    return stolen;
+}
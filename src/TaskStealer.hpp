@@ -0,0 +1,44 @@
+#pragma once
+
+#include "TARServiceImpl.hpp"
+#include "PeerConnectionManager.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Pulls work from overloaded peers whenever the local queue runs low. A round
+// runs as soon as the queue drops below UNDERLOADED_THRESHOLD (checked every
+// STEAL_CHECK_INTERVAL_MS) or when wake() is called, and asks each overloaded
+// peer for half the queue-length gap in a single StealTasks call.
+class TaskStealer {
+public:
+    TaskStealer(PeerConnectionManager* peer_connections, TARServiceImpl* service);
+    ~TaskStealer();
+
+    void start();
+    void stop();
+
+    // Request a round now, e.g. after heartbeats brought fresh peer metrics
+    void wake();
+
+private:
+    void run();
+
+    // Returns the number of tasks stolen
+    int stealRound();
+
+    PeerConnectionManager* peer_connections_;
+    TARServiceImpl* service_;
+    int underloaded_threshold_;
+    int overloaded_threshold_;
+    int max_steal_batch_;
+    int rpc_deadline_ms_;
+    std::chrono::milliseconds check_interval_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool wake_requested_ = false;
+    bool stopping_ = false;
+    std::thread thread_;
+};
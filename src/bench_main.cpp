@@ -0,0 +1,250 @@
+#include <grpcpp/grpcpp.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "tar.grpc.pb.h"
+#include "EnvConfig.hpp"
+#include "Stats.hpp"
+
+// Load generator for one or more TAR servers.
+//
+// Closed loop (BENCH_RATE=0): BENCH_CONCURRENCY calls are kept in flight and
+// each completion immediately issues the next one.
+// Open loop (BENCH_RATE>0): calls are issued on a fixed schedule regardless of
+// completions, and latency is measured from the scheduled send time, so a
+// stalled server shows up in the tail instead of silently lowering the load.
+//
+// Every request is drawn from a generator seeded with BENCH_SEED, so two runs
+// with the same settings send the same sequence of tasks.
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct BenchConfig {
+    int rate = GetEnvOrDefault("BENCH_RATE", 0);                   // Calls per second; 0 = closed loop
+    int concurrency = GetEnvOrDefault("BENCH_CONCURRENCY", 16);     // Calls in flight (closed loop)
+    int duration_s = GetEnvOrDefault("BENCH_DURATION_S", 10);
+    int warmup_s = GetEnvOrDefault("BENCH_WARMUP_S", 1);           // Issued but not measured
+    int weight_low = GetEnvOrDefault("BENCH_WEIGHT_LOW", 1);       // Priority mix
+    int weight_moderate = GetEnvOrDefault("BENCH_WEIGHT_MODERATE", 1);
+    int weight_urgent = GetEnvOrDefault("BENCH_WEIGHT_URGENT", 1);
+    int payload_min = GetEnvOrDefault("BENCH_PAYLOAD_MIN", 64);    // Bytes, uniformly distributed
+    int payload_max = GetEnvOrDefault("BENCH_PAYLOAD_MAX", 64);
+    int transfer_percent = GetEnvOrDefault("BENCH_TRANSFER_PERCENT", 0); // Share of RequestTaskTransfer calls
+    int deadline_ms = GetEnvOrDefault("BENCH_DEADLINE_MS", 0);      // Task deadline after creation; 0 = none
+    int seed = GetEnvOrDefault("BENCH_SEED", 1);
+};
+
+enum class Rpc { RouteTask, RequestTaskTransfer };
+
+struct PendingCall {
+    Rpc rpc;
+    tar::Priority priority;
+    Clock::time_point scheduled;
+    bool measured;
+
+    grpc::ClientContext context;
+    grpc::Status status;
+    tar::RouteTaskResponse route_response;
+    tar::Task transfer_response;
+    std::unique_ptr<grpc::ClientAsyncResponseReader<tar::RouteTaskResponse>> route_reader;
+    std::unique_ptr<grpc::ClientAsyncResponseReader<tar::Task>> transfer_reader;
+};
+
+// Results of one RPC (and priority, for RouteTask)
+struct Series {
+    std::string name;
+    LatencyHistogram latency;
+    uint64_t errors = 0;
+    uint64_t rejected = 0; // RESOURCE_EXHAUSTED from admission control
+};
+
+class LoadGenerator {
+public:
+    LoadGenerator(const std::vector<std::string>& servers, const BenchConfig& config)
+        : config_(config),
+          rng_(config.seed),
+          priorities_({static_cast<double>(config.weight_low), static_cast<double>(config.weight_moderate),
+                       static_cast<double>(config.weight_urgent)}),
+          payload_size_(std::max(0, config.payload_min), std::max(config.payload_min, config.payload_max)),
+          percent_(0, 99),
+          payload_bytes_(std::max(config.payload_min, config.payload_max), 'x') {
+        for (const auto& server : servers) {
+            stubs_.push_back(tar::TARService::NewStub(grpc::CreateChannel(server, grpc::InsecureChannelCredentials())));
+        }
+        for (int priority = 0; priority < tar::Priority_ARRAYSIZE; ++priority) {
+            route_series_[priority].name = "RouteTask/" + tar::Priority_Name(static_cast<tar::Priority>(priority));
+        }
+        transfer_series_.name = "RequestTaskTransfer";
+
+        requester_.set_server_id("tar_bench");
+    }
+
+    void run() {
+        start_ = Clock::now();
+        measure_from_ = start_ + std::chrono::seconds(config_.warmup_s);
+        end_ = measure_from_ + std::chrono::seconds(config_.duration_s);
+
+        bool open_loop = config_.rate > 0;
+        auto interval = open_loop ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / config_.rate))
+                                  : Clock::duration::zero();
+        Clock::time_point next_send = start_;
+
+        if (!open_loop) {
+            for (int i = 0; i < config_.concurrency; ++i) {
+                issue(start_);
+            }
+        }
+
+        // One thread both paces the open-loop schedule and reaps completions
+        while (true) {
+            Clock::time_point now = Clock::now();
+            if (open_loop) {
+                for (; next_send <= now && next_send < end_; next_send += interval) {
+                    issue(next_send);
+                }
+            }
+            if (now >= end_ && in_flight_ == 0) break;
+
+            Clock::time_point wake = open_loop && next_send < end_ ? next_send : std::max(end_, now + std::chrono::milliseconds(100));
+            void* tag;
+            bool ok;
+            // gRPC deadlines only take the system clock
+            auto result = cq_.AsyncNext(&tag, &ok, std::chrono::system_clock::now() + (wake - now));
+            if (result == grpc::CompletionQueue::SHUTDOWN) break;
+            if (result != grpc::CompletionQueue::GOT_EVENT) continue;
+
+            complete(std::unique_ptr<PendingCall>(static_cast<PendingCall*>(tag)));
+            if (!open_loop && Clock::now() < end_) {
+                issue(Clock::now());
+            }
+        }
+        cq_.Shutdown();
+    }
+
+    void report() const {
+        double seconds = config_.duration_s;
+        std::printf("mode=%s servers=%zu duration=%ds warmup=%ds %s=%d payload=%d-%dB seed=%d\n",
+                    config_.rate > 0 ? "open" : "closed", stubs_.size(), config_.duration_s, config_.warmup_s,
+                    config_.rate > 0 ? "rate" : "concurrency", config_.rate > 0 ? config_.rate : config_.concurrency,
+                    config_.payload_min, std::max(config_.payload_min, config_.payload_max), config_.seed);
+        std::printf("%-26s %10s %8s %8s %12s %10s %10s %10s %10s\n",
+                    "series", "calls", "errors", "rejected", "calls/s", "p50_us", "p99_us", "p999_us", "max_us");
+
+        uint64_t total = 0;
+        auto print = [&](const Series& series) {
+            auto snapshot = series.latency.snapshot();
+            if (snapshot.count == 0 && series.errors == 0 && series.rejected == 0) return;
+            total += snapshot.count;
+            std::printf("%-26s %10llu %8llu %8llu %12.1f %10llu %10llu %10llu %10llu\n", series.name.c_str(),
+                        static_cast<unsigned long long>(snapshot.count), static_cast<unsigned long long>(series.errors),
+                        static_cast<unsigned long long>(series.rejected), snapshot.count / seconds,
+                        static_cast<unsigned long long>(snapshot.percentile(0.5)),
+                        static_cast<unsigned long long>(snapshot.percentile(0.99)),
+                        static_cast<unsigned long long>(snapshot.percentile(0.999)),
+                        static_cast<unsigned long long>(snapshot.max_us));
+        };
+        for (int priority = tar::Priority_ARRAYSIZE - 1; priority >= 0; --priority) {
+            print(route_series_[priority]);
+        }
+        print(transfer_series_);
+        std::printf("total throughput: %.1f calls/s\n", total / seconds);
+    }
+
+private:
+    void issue(Clock::time_point scheduled) {
+        auto call = std::make_unique<PendingCall>();
+        call->scheduled = scheduled;
+        call->measured = scheduled >= measure_from_;
+        auto& stub = stubs_[next_stub_++ % stubs_.size()];
+
+        if (percent_(rng_) < config_.transfer_percent) {
+            call->rpc = Rpc::RequestTaskTransfer;
+            call->priority = tar::Priority::LOW;
+            call->transfer_reader = stub->AsyncRequestTaskTransfer(&call->context, requester_, &cq_);
+            call->transfer_reader->Finish(&call->transfer_response, &call->status, call.get());
+        } else {
+            call->rpc = Rpc::RouteTask;
+            call->priority = static_cast<tar::Priority>(priorities_(rng_));
+
+            tar::RouteTaskRequest request;
+            tar::Task* task = request.mutable_task();
+            task->set_id("bench_" + std::to_string(next_task_id_++));
+            task->set_payload(payload_bytes_.data(), payload_size_(rng_));
+            task->set_priority(call->priority);
+            task->set_timestamp(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count());
+            if (config_.deadline_ms > 0) {
+                task->set_deadline(task->timestamp() + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::milliseconds(config_.deadline_ms)).count());
+            }
+            *request.mutable_requester_metrics() = requester_;
+
+            call->route_reader = stub->AsyncRouteTask(&call->context, request, &cq_);
+            call->route_reader->Finish(&call->route_response, &call->status, call.get());
+        }
+        ++in_flight_;
+        call.release(); // Owned by the completion queue until complete()
+    }
+
+    void complete(std::unique_ptr<PendingCall> call) {
+        --in_flight_;
+        if (!call->measured) return;
+
+        Series& series = call->rpc == Rpc::RouteTask ? route_series_[call->priority] : transfer_series_;
+        // Shed tasks are the server protecting itself, not failures; the rate of
+        // accepted calls is the goodput
+        if (call->status.error_code() == grpc::StatusCode::RESOURCE_EXHAUSTED) {
+            ++series.rejected;
+            return;
+        }
+        // NOT_FOUND from RequestTaskTransfer only means the server had nothing to give
+        if (!call->status.ok() && call->status.error_code() != grpc::StatusCode::NOT_FOUND) {
+            ++series.errors;
+            return;
+        }
+        series.latency.record(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - call->scheduled).count());
+    }
+
+    BenchConfig config_;
+    std::vector<std::unique_ptr<tar::TARService::Stub>> stubs_;
+    grpc::CompletionQueue cq_;
+    tar::ServerMetrics requester_;
+
+    std::mt19937_64 rng_;
+    std::discrete_distribution<int> priorities_;
+    std::uniform_int_distribution<int> payload_size_;
+    std::uniform_int_distribution<int> percent_;
+    std::string payload_bytes_;
+
+    size_t next_stub_ = 0;
+    uint64_t next_task_id_ = 0;
+    size_t in_flight_ = 0;
+    Clock::time_point start_, measure_from_, end_;
+
+    Series route_series_[tar::Priority_ARRAYSIZE];
+    Series transfer_series_;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <server_address1> [server_address2] ..." << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> servers(argv + 1, argv + argc);
+    BenchConfig config;
+    LoadGenerator generator(servers, config);
+    generator.run();
+    generator.report();
+    return 0;
+}
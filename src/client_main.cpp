@@ -6,8 +6,11 @@
 #include <thread>
 #include <random>
 #include <vector>
+#include <mutex>
+#include <condition_variable>
 
 #include "tar.grpc.pb.h"
+#include "EnvConfig.hpp"
 
 using grpc::Channel;
 using grpc::ClientContext;
@@ -21,20 +24,36 @@ public:
             grpc::CreateChannel(server_address, grpc::InsecureChannelCredentials()));
     }
 
+    static tar::Task MakeTask(const std::string& task_id, tar::Priority priority) {
+        // Optional synthetic work for the servers' executors to perform
+        static const int cpu_ms = GetEnvOrDefault("CLIENT_TASK_CPU_MS", 0);
+        static const int sleep_ms = GetEnvOrDefault("CLIENT_TASK_SLEEP_MS", 0);
+        static const int deadline_ms = GetEnvOrDefault("CLIENT_TASK_DEADLINE_MS", 0);
+
+        tar::Task task;
+        task.set_id(task_id);
+        if (cpu_ms > 0) {
+            task.set_payload("cpu:" + std::to_string(cpu_ms));
+        } else if (sleep_ms > 0) {
+            task.set_payload("sleep:" + std::to_string(sleep_ms));
+        } else {
+            task.set_payload("payload_" + task_id);
+        }
+        task.set_priority(priority);
+        task.set_timestamp(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        if (deadline_ms > 0) {
+            task.set_deadline(task.timestamp() + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::milliseconds(deadline_ms)).count());
+        }
+        task.set_hop_count(0); // Initialize hop count to 0
+        return task;
+    }
+
     bool SendTask(const std::string& task_id, tar::Priority priority) {
         tar::RouteTaskRequest request;
-        tar::Task* task = request.mutable_task();
-        task->set_id(task_id);
-        task->set_payload("payload_" + task_id);
-        task->set_priority(priority);
-        task->set_timestamp(std::chrono::system_clock::now().time_since_epoch().count());
-        task->set_hop_count(0); // Initialize hop count to 0
-
-        tar::ServerMetrics* metrics = request.mutable_requester_metrics();
-        metrics->set_server_id("test_client");
-        metrics->set_cpu_utilization(0.0);
-        metrics->set_queue_length(0);
-        metrics->set_last_heartbeat(std::chrono::system_clock::now().time_since_epoch().count());
+        *request.mutable_task() = MakeTask(task_id, priority);
+        FillRequesterMetrics(request.mutable_requester_metrics());
 
         tar::RouteTaskResponse response;
         ClientContext context;
@@ -53,11 +72,163 @@ public:
         }
     }
 
+    // Route many tasks with a single RouteTaskBatch round trip
+    bool SendTaskBatch(std::vector<tar::Task> tasks) {
+        tar::RouteTaskBatchRequest request;
+        request.mutable_tasks()->Reserve(tasks.size());
+        for (auto& task : tasks) {
+            *request.add_tasks() = std::move(task);
+        }
+        FillRequesterMetrics(request.mutable_requester_metrics());
+
+        tar::RouteTaskBatchResponse response;
+        ClientContext context;
+        Status status = stub_->RouteTaskBatch(&context, request, &response);
+
+        if (!status.ok()) {
+            std::cerr << "[Client] RouteTaskBatch failed: " << status.error_message() << std::endl;
+            return false;
+        }
+
+        for (int i = 0; i < response.results_size(); ++i) {
+            if (!response.results(i).rejection_reason().empty()) {
+                std::cerr << "[Client] Task " << request.tasks(i).id() << " rejected: "
+                          << response.results(i).rejection_reason() << std::endl;
+                continue;
+            }
+            std::cout << "[Client] Task " << request.tasks(i).id() << " routed to: ";
+            for (const auto& s : response.results(i).target_servers()) {
+                std::cout << s << " ";
+            }
+            std::cout << std::endl;
+        }
+        return true;
+    }
+
+    // Submit tasks over one long-lived SubmitTasks stream. Writes block when the
+    // server stops reading, which is how it applies backpressure.
+    bool StreamTasks(const std::vector<tar::Task>& tasks, int task_interval_ms) {
+        ClientContext context;
+        auto stream = stub_->SubmitTasks(&context);
+
+        std::thread reader([&stream] {
+            tar::RouteTaskResponse response;
+            while (stream->Read(&response)) {
+                if (!response.rejection_reason().empty()) {
+                    std::cerr << "[Client] Task " << response.task_id() << " rejected: "
+                              << response.rejection_reason() << std::endl;
+                    continue;
+                }
+                std::cout << "[Client] Task " << response.task_id() << " routed to: ";
+                for (const auto& s : response.target_servers()) {
+                    std::cout << s << " ";
+                }
+                std::cout << std::endl;
+            }
+        });
+
+        for (const auto& task : tasks) {
+            if (!stream->Write(task)) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(task_interval_ms));
+        }
+        stream->WritesDone();
+        reader.join();
+
+        Status status = stream->Finish();
+        if (!status.ok()) {
+            std::cerr << "[Client] SubmitTasks failed: " << status.error_message() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Dump the server's instrumentation in Prometheus text format
+    void PrintStats() {
+        tar::StatsResponse response;
+        ClientContext context;
+        Status status = stub_->GetStats(&context, tar::StatsRequest(), &response);
+        if (!status.ok()) {
+            std::cerr << "[Client] GetStats failed: " << status.error_message() << std::endl;
+            return;
+        }
+        std::cout << "[Client] Stats from " << server_address_ << ":\n" << response.prometheus_text();
+    }
+
 private:
+    static void FillRequesterMetrics(tar::ServerMetrics* metrics) {
+        metrics->set_server_id("test_client");
+        metrics->set_cpu_utilization(0.0);
+        metrics->set_queue_length(0);
+        metrics->set_last_heartbeat(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+
     std::string server_address_;
     std::unique_ptr<tar::TARService::Stub> stub_;
 };
 
+// Coalesces individual submissions into RouteTaskBatch calls. A batch is sent
+// once max_batch_size tasks are pending or the oldest has waited window_ms.
+class TaskBatcher {
+public:
+    TaskBatcher(TARClient* client, size_t max_batch_size, int window_ms)
+        : client_(client), max_batch_size_(max_batch_size), window_(window_ms),
+          flush_thread_(&TaskBatcher::FlushLoop, this) {}
+
+    ~TaskBatcher() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_one();
+        flush_thread_.join(); // Sends whatever is still pending
+    }
+
+    void Submit(tar::Task task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_.empty()) {
+            oldest_ = std::chrono::steady_clock::now();
+        }
+        pending_.push_back(std::move(task));
+        if (pending_.size() >= max_batch_size_) {
+            cv_.notify_one();
+        }
+    }
+
+private:
+    void FlushLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            if (pending_.empty()) {
+                if (stopping_) return;
+                cv_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+                continue;
+            }
+
+            // Wait for the batch to fill up or its window to expire
+            cv_.wait_until(lock, oldest_ + window_, [this] {
+                return stopping_ || pending_.size() >= max_batch_size_;
+            });
+
+            std::vector<tar::Task> batch;
+            batch.swap(pending_);
+            lock.unlock();
+            client_->SendTaskBatch(std::move(batch));
+            lock.lock();
+        }
+    }
+
+    TARClient* client_;
+    size_t max_batch_size_;
+    std::chrono::milliseconds window_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<tar::Task> pending_;
+    std::chrono::steady_clock::time_point oldest_;
+    bool stopping_ = false;
+    std::thread flush_thread_; // Declared last so it starts after the state above
+};
+
 // Simulate test workload
 int main(int argc, char** argv) {
     if (argc < 2) {
@@ -65,23 +236,67 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    // Workload shape and optional batching, configurable through the environment
+    int num_tasks = GetEnvOrDefault("CLIENT_NUM_TASKS", 10);
+    int task_interval_ms = GetEnvOrDefault("CLIENT_TASK_INTERVAL_MS", 500);
+    int batch_size = GetEnvOrDefault("CLIENT_BATCH_SIZE", 1);
+    int batch_window_ms = GetEnvOrDefault("CLIENT_BATCH_WINDOW_MS", 10);
+    bool use_stream = GetEnvOrDefault("CLIENT_STREAM", 0) != 0;
+    bool print_stats = GetEnvOrDefault("CLIENT_PRINT_STATS", 0) != 0;
+
     std::vector<std::unique_ptr<TARClient>> clients;
     for (int i = 1; i < argc; ++i) {
         clients.emplace_back(std::make_unique<TARClient>(argv[i]));
     }
 
+    std::vector<std::unique_ptr<TaskBatcher>> batchers;
+    if (batch_size > 1) {
+        for (auto& client : clients) {
+            batchers.emplace_back(std::make_unique<TaskBatcher>(client.get(), batch_size, batch_window_ms));
+        }
+    }
+
     std::random_device rd;
     std::mt19937 gen(rd());
     std::uniform_int_distribution<> priority_dist(0, 2);
     std::uniform_int_distribution<> client_dist(0, clients.size() - 1);
 
-    for (int i = 0; i < 10; ++i) {
-        std::string task_id = "task_" + std::to_string(i);
-        tar::Priority priority = static_cast<tar::Priority>(priority_dist(gen));
-        int client_index = client_dist(gen);
-        clients[client_index]->SendTask(task_id, priority);
+    if (use_stream) {
+        // One stream per server, each fed its share of the workload concurrently
+        std::vector<std::vector<tar::Task>> per_client(clients.size());
+        for (int i = 0; i < num_tasks; ++i) {
+            tar::Priority priority = static_cast<tar::Priority>(priority_dist(gen));
+            per_client[client_dist(gen)].push_back(TARClient::MakeTask("task_" + std::to_string(i), priority));
+        }
+
+        std::vector<std::thread> producers;
+        for (size_t c = 0; c < clients.size(); ++c) {
+            producers.emplace_back([&, c] { clients[c]->StreamTasks(per_client[c], task_interval_ms); });
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+    } else {
+        for (int i = 0; i < num_tasks; ++i) {
+            std::string task_id = "task_" + std::to_string(i);
+            tar::Priority priority = static_cast<tar::Priority>(priority_dist(gen));
+            int client_index = client_dist(gen);
+
+            if (batchers.empty()) {
+                clients[client_index]->SendTask(task_id, priority);
+            } else {
+                batchers[client_index]->Submit(TARClient::MakeTask(task_id, priority));
+            }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            std::this_thread::sleep_for(std::chrono::milliseconds(task_interval_ms));
+        }
+        batchers.clear(); // Flush pending batches before reading stats
+    }
+
+    if (print_stats) {
+        for (auto& client : clients) {
+            client->PrintStats();
+        }
     }
 
     return 0;
@@ -0,0 +1,131 @@
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "TARAlgorithm.hpp"
+
+// Google Benchmark suite for the routing core, against synthetic peers.
+// Run with --benchmark_filter=<regex> to pick a subset.
+
+namespace {
+
+std::vector<std::string> PeerIds(int count) {
+    std::vector<std::string> ids;
+    for (int i = 0; i < count; ++i) {
+        ids.push_back("peer_" + std::to_string(i));
+    }
+    return ids;
+}
+
+// An algorithm instance that has heard one heartbeat from every peer
+std::unique_ptr<TARAlgorithm> MakeAlgorithm(int peer_count) {
+    auto ids = PeerIds(peer_count);
+    auto algorithm = std::make_unique<TARAlgorithm>("self", ids);
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> queue_length(0, 1000);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (const auto& id : ids) {
+        tar::ServerMetrics metrics;
+        metrics.set_server_id(id);
+        metrics.set_cpu_utilization(unit(rng));
+        metrics.set_queue_length(queue_length(rng));
+        metrics.set_last_heartbeat(ClockSource::real().wallNanos());
+        metrics.set_network_latency(unit(rng) * 10);
+        algorithm->updateServerMetrics(metrics, TARAlgorithm::MetricsSource::kHeartbeatReply);
+    }
+    return algorithm;
+}
+
+tar::Task MakeTask(uint64_t id, tar::Priority priority) {
+    tar::Task task;
+    task.set_id("task_" + std::to_string(id));
+    task.set_payload(std::string(64, 'x'));
+    task.set_priority(priority);
+    return task;
+}
+
+tar::ServerMetrics Requester() {
+    tar::ServerMetrics requester;
+    requester.set_server_id("bench_client");
+    return requester;
+}
+
+void BM_RouteTask(benchmark::State& state) {
+    auto algorithm = MakeAlgorithm(state.range(0));
+    auto requester = Requester();
+    uint64_t id = 0;
+    AdmissionDecision admission; // Admission control is part of every RouteTask call
+
+    for (auto _ : state) {
+        auto targets = algorithm->routeTask(std::make_shared<tar::Task>(MakeTask(id, static_cast<tar::Priority>(id % 3))),
+                                            requester, &admission);
+        benchmark::DoNotOptimize(targets);
+        ++id;
+
+        // Keep the local queue from growing without bound
+        if (id % 10000 == 0) {
+            state.PauseTiming();
+            while (algorithm->popTask()) {}
+            state.ResumeTiming();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RouteTask)->RangeMultiplier(4)->Range(4, 1024);
+
+void BM_RequestTaskTransfer(benchmark::State& state) {
+    auto algorithm = MakeAlgorithm(8);
+    auto requester = Requester();
+    const int queue_depth = state.range(0);
+    uint64_t id = 0;
+
+    auto refill = [&] {
+        for (int i = 0; i < queue_depth; ++i) {
+            algorithm->addTaskToQueue(MakeTask(id++, static_cast<tar::Priority>(i % 3)));
+        }
+    };
+    refill();
+
+    for (auto _ : state) {
+        auto task = algorithm->requestTaskTransfer(requester);
+        if (!task) {
+            state.PauseTiming();
+            refill();
+            state.ResumeTiming();
+            continue;
+        }
+        benchmark::DoNotOptimize(task);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RequestTaskTransfer)->RangeMultiplier(10)->Range(10, 100000);
+
+void BM_ElectLeader(benchmark::State& state) {
+    auto algorithm = MakeAlgorithm(state.range(0));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(algorithm->electLeader());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ElectLeader)->RangeMultiplier(4)->Range(4, 1024);
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // Peers must not turn suspect while a long benchmark runs, and per-call
+    // INFO logging (leader elections) would only measure the logger
+    setenv("HEARTBEAT_INTERVAL_MS", "3600000", 0);
+    setenv("LOG_LEVEL", "2", 0);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
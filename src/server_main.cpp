@@ -1,4 +1,11 @@
 #include "TARServiceImpl.hpp"
+#include "PeerConnectionManager.hpp"
+#include "AsyncTARServer.hpp"
+#include "TaskStealer.hpp"
+#include "TaskExecutor.hpp"
+#include "EnvConfig.hpp"
+#include "Stats.hpp"
+#include "Logger.hpp"
 #include <grpcpp/grpcpp.h>
 #include <grpcpp/health_check_service_interface.h>
 #include <grpcpp/ext/proto_server_reflection_plugin.h>
@@ -8,135 +15,300 @@
 #include <string>
 #include <chrono>
 #include <atomic>
-#include <cstdlib> // For std::getenv
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <random>
 #include <sysinfo.h> // Include the sysinfo library
 
 // Atomic flag to control the heartbeat thread
 std::atomic<bool> keep_sending_heartbeats(true);
 
-// Helper function to get environment variable or default value
-int GetEnvOrDefault(const char* env_var, int default_value) {
-    const char* value = std::getenv(env_var);
-    return value ? std::stoi(value) : default_value;
+// In-flight state for one asynchronous heartbeat RPC
+struct AsyncHeartbeatCall {
+    std::string peer;
+    grpc::ClientContext context;
+    tar::ServerMetrics response;
+    grpc::Status status;
+    std::chrono::steady_clock::time_point start;
+    std::unique_ptr<grpc::ClientAsyncResponseReader<tar::ServerMetrics>> reader;
+};
+
+// Send a heartbeat to every given peer at once and hand each reply to on_reply
+// as it completes. Every call carries its own deadline, so a tick costs max(RTT).
+void FanOutHeartbeats(const tar::ServerMetrics& metrics,
+                      const std::vector<std::string>& peers,
+                      PeerConnectionManager* peer_connections,
+                      int deadline_ms,
+                      const std::function<void(AsyncHeartbeatCall&, float)>& on_reply) {
+    grpc::CompletionQueue cq;
+    std::vector<std::unique_ptr<AsyncHeartbeatCall>> calls;
+
+    for (const auto& peer : peers) {
+        auto call = std::make_unique<AsyncHeartbeatCall>();
+        call->peer = peer;
+        call->context.set_deadline(std::chrono::system_clock::now() + std::chrono::milliseconds(deadline_ms));
+        call->start = std::chrono::steady_clock::now();
+        call->reader = peer_connections->getStub(peer)->PrepareAsyncHeartbeat(&call->context, metrics, &cq);
+        call->reader->StartCall();
+        call->reader->Finish(&call->response, &call->status, call.get());
+        calls.push_back(std::move(call));
+    }
+
+    void* tag;
+    bool ok;
+    for (size_t pending = calls.size(); pending > 0 && cq.Next(&tag, &ok); --pending) {
+        auto* call = static_cast<AsyncHeartbeatCall*>(tag);
+        auto elapsed = std::chrono::steady_clock::now() - call->start;
+        float latency_ms = std::chrono::duration<float, std::milli>(elapsed).count();
+        on_reply(*call, latency_ms);
+    }
+
+    cq.Shutdown();
+    while (cq.Next(&tag, &ok)) {} // Drain before the calls are destroyed
 }
 
-// Function to send heartbeats to peers
-void SendHeartbeats(const std::string& server_id,
-                    const std::vector<std::string>& peer_addresses,
-                    TARServiceImpl* service) {
-    int leader_timeout = GetEnvOrDefault("LEADER_TIMEOUT", 10); // Timeout in seconds
-    auto last_leader_heartbeat = std::chrono::system_clock::now();
+// In-flight state for one push-pull gossip exchange
+struct AsyncGossipCall {
+    std::string peer;
+    grpc::ClientContext context;
+    tar::GossipMessage request;
+    tar::GossipMessage response;
+    grpc::Status status;
+    std::chrono::steady_clock::time_point start;
+    std::unique_ptr<grpc::ClientAsyncResponseReader<tar::GossipMessage>> reader;
+};
+
+// Gossip with `fanout` random peers at once. Each request carries only the
+// entries that peer has not seen, so a tick costs O(fanout) bounded messages
+// instead of one full heartbeat per peer.
+void GossipRound(MetricsGossip& gossip,
+                 PeerConnectionManager* peer_connections,
+                 int fanout,
+                 int deadline_ms,
+                 const std::function<void(AsyncGossipCall&, float)>& on_reply) {
+    static thread_local std::mt19937 gen(std::random_device{}());
+    auto peers = peer_connections->getPeerAddresses();
+    std::shuffle(peers.begin(), peers.end(), gen);
+    peers.resize(std::min<size_t>(peers.size(), std::max(1, fanout)));
+
+    grpc::CompletionQueue cq;
+    std::vector<std::unique_ptr<AsyncGossipCall>> calls;
+
+    for (const auto& peer : peers) {
+        auto call = std::make_unique<AsyncGossipCall>();
+        call->peer = peer;
+        call->request = gossip.buildFor(peer);
+        call->context.set_deadline(std::chrono::system_clock::now() + std::chrono::milliseconds(deadline_ms));
+        call->start = std::chrono::steady_clock::now();
+        call->reader = peer_connections->getStub(peer)->PrepareAsyncGossip(&call->context, call->request, &cq);
+        call->reader->StartCall();
+        call->reader->Finish(&call->response, &call->status, call.get());
+        calls.push_back(std::move(call));
+    }
 
+    void* tag;
+    bool ok;
+    for (size_t pending = calls.size(); pending > 0 && cq.Next(&tag, &ok); --pending) {
+        auto* call = static_cast<AsyncGossipCall*>(tag);
+        auto elapsed = std::chrono::steady_clock::now() - call->start;
+        on_reply(*call, std::chrono::duration<float, std::milli>(elapsed).count());
+    }
+
+    cq.Shutdown();
+    while (cq.Next(&tag, &ok)) {} // Drain before the calls are destroyed
+}
+
+// Report submit-to-quorum replication latency per priority
+void LogReplicationLatency(const ReplicationTracker& tracker) {
+    for (int priority = tar::Priority_MAX; priority >= tar::Priority_MIN; --priority) {
+        auto stats = tracker.quorumLatency(static_cast<tar::Priority>(priority));
+        if (stats.count == 0) continue;
+        LOG_INFO("Replication", tar::Priority_Name(static_cast<tar::Priority>(priority)),
+                 " quorum latency: avg ", stats.total_us / stats.count / 1000.0,
+                 " ms, max ", stats.max_us / 1000.0, " ms over ", stats.count, " tasks");
+    }
+}
+
+// Function to send heartbeats to peers
+void SendHeartbeats(PeerConnectionManager* peer_connections,
+                    TARServiceImpl* service,
+                    TaskStealer* stealer) {
     // Load thresholds from environment variables or use default values
     int underloaded_threshold = GetEnvOrDefault("UNDERLOADED_THRESHOLD", 2);
-    int overloaded_threshold = GetEnvOrDefault("OVERLOADED_THRESHOLD", 10);
-    int max_hop_count = GetEnvOrDefault("MAX_HOP_COUNT", 2);
+    int heartbeat_interval_ms = GetEnvOrDefault("HEARTBEAT_INTERVAL_MS", 5000);
+    // A reply that lands after the next tick has started is useless, and waiting
+    // for it would delay failure detection by a slow peer's full deadline
+    int heartbeat_deadline_ms = std::min(GetEnvOrDefault("HEARTBEAT_DEADLINE_MS", 1000), heartbeat_interval_ms);
+
+    // GOSSIP_MODE=1 replaces the all-to-all heartbeat with delta gossip to a few random peers
+    bool gossip_mode = GetEnvOrDefault("GOSSIP_MODE", 0) != 0;
+    int gossip_fanout = GetEnvOrDefault("GOSSIP_FANOUT", 3);
 
     sysinfo::System system_info; // Create a system info object
     system_info.refresh_cpu();   // Refresh CPU metrics
 
     while (keep_sending_heartbeats) {
+        auto tick_start = std::chrono::steady_clock::now();
         system_info.refresh_cpu(); // Refresh CPU metrics before each heartbeat
+        service->getAlgorithm().setLocalCpuUtilization(system_info.cpu_usage());
 
-        tar::ServerMetrics metrics;
-        metrics.set_server_id(server_id);
-        metrics.set_cpu_utilization(system_info.cpu_usage()); // Set actual CPU utilization
-        metrics.set_queue_length(service->getTaskQueueLength());
-        metrics.set_last_heartbeat(std::chrono::system_clock::now().time_since_epoch().count());
+        tar::ServerMetrics metrics = service->getAlgorithm().getLocalMetrics();
 
         bool is_underloaded = metrics.queue_length() < underloaded_threshold;
 
-        for (const auto& peer : peer_addresses) {
-            auto stub = tar::TARService::NewStub(
-                grpc::CreateChannel(peer, grpc::InsecureChannelCredentials()));
-
-            tar::ServerMetrics response;
-            grpc::ClientContext context;
+        peer_connections->refreshConnections();
 
-            // Measure latency
-            auto start = std::chrono::high_resolution_clock::now();
-            auto status = stub->Heartbeat(&context, metrics, &response);
-            auto end = std::chrono::high_resolution_clock::now();
+        if (gossip_mode) {
+            MetricsGossip& gossip = service->getGossip();
+            gossip.updateLocal(metrics);
 
-            if (status.ok()) {
-                auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-                std::cout << "[Latency] Measured latency to " << peer << ": " << latency << " ms" << std::endl;
-
-                // Update metrics
-                response.set_network_latency(latency);
-                service->updateServerMetrics(response);
-
-                // Update leader heartbeat if the current leader responds
-                if (response.server_id() == service->getAlgorithm().getCurrentLeader()) {
-                    last_leader_heartbeat = std::chrono::system_clock::now();
+            GossipRound(gossip, peer_connections, gossip_fanout, heartbeat_deadline_ms,
+                        [&](AsyncGossipCall& call, float latency) {
+                if (!call.status.ok()) {
+                    LOG_WARN("Gossip", "Failed to reach ", call.peer, ": ", call.status.error_message());
+                    gossip.forgetPeer(call.peer); // Resend everything next time
+                    return;
                 }
 
-                // Check if the peer is overloaded
-                bool is_overloaded = response.queue_length() > overloaded_threshold;
-
-                // Steal tasks if this server is underloaded and the peer is overloaded
-                if (is_underloaded && is_overloaded) {
-                    tar::Task stolen_task;
-                    grpc::ClientContext steal_context;
-                    auto steal_status = stub->RequestTaskTransfer(&steal_context, metrics, &stolen_task);
-
-                    if (steal_status.ok()) {
-                        // Check the hop count of the stolen task
-                        if (stolen_task.hop_count() < max_hop_count) {
-                            stolen_task.set_hop_count(stolen_task.hop_count() + 1);
-                            std::cout << "[Task Stealing] Stole task: " << stolen_task.id()
-                                      << " (Hop Count: " << stolen_task.hop_count() << ") from " << peer << std::endl;
-                            service->addTaskToQueue(stolen_task); // Add the stolen task to the local queue
-                        } else {
-                            std::cout << "[Task Stealing] Task " << stolen_task.id()
-                                      << " has reached max hop count. Keeping it on the current server." << std::endl;
-                        }
-                    } else {
-                        std::cout << "[Task Stealing] No tasks available to steal from " << peer << std::endl;
-                    }
+                peer_connections->bindServerId(call.peer, call.response.sender_id());
+                gossip.observeLatency(call.response.sender_id(), latency);
+                for (const auto& peer_metrics : gossip.mergeReply(call.peer, call.response)) {
+                    service->updateServerMetrics(peer_metrics, TARAlgorithm::MetricsSource::kGossip);
                 }
-            } else {
-                std::cerr << "[Heartbeat] Failed to send to " << peer << ": " << status.error_message() << std::endl;
+            });
+        } else {
+            // Hierarchical mode leaves out other zones' members; addresses
+            // that have never answered are always tried
+            TARAlgorithm& algorithm = service->getAlgorithm();
+            std::vector<std::string> peers;
+            for (const auto& address : peer_connections->getPeerAddresses()) {
+                std::string peer_id = peer_connections->getServerId(address);
+                if (!peer_id.empty() && !algorithm.shouldHeartbeat(peer_id)) continue;
+                peers.push_back(address);
+                bool cross_zone = !peer_id.empty() && algorithm.getPeerZone(peer_id) == PeerZone::kOther;
+                (cross_zone ? GetServerStats().cross_zone_heartbeats : GetServerStats().zone_heartbeats)
+                    .fetch_add(1, std::memory_order_relaxed);
             }
+
+            FanOutHeartbeats(metrics, peers, peer_connections, heartbeat_deadline_ms,
+                             [&](AsyncHeartbeatCall& call, float latency) {
+                if (!call.status.ok()) {
+                    LOG_WARN("Heartbeat", "Failed to send to ", call.peer, ": ", call.status.error_message());
+                    return;
+                }
+
+                LOG_DEBUG("Latency", "Measured latency to ", call.peer, ": ", latency, " ms");
+
+                // Update metrics
+                peer_connections->bindServerId(call.peer, call.response.server_id());
+                call.response.set_network_latency(latency);
+                service->updateServerMetrics(call.response, TARAlgorithm::MetricsSource::kHeartbeatReply);
+            });
         }
 
-        // Check if the leader is unreachable
-        auto now = std::chrono::system_clock::now();
-        if (std::chrono::duration_cast<std::chrono::seconds>(now - last_leader_heartbeat).count() > leader_timeout) {
-            std::cout << "[Leader Election] Current leader is unreachable. Electing a new leader..." << std::endl;
+        // Fresh peer metrics: let the stealer re-check even if its last round found nothing
+        if (is_underloaded) stealer->wake();
+
+        LogReplicationLatency(service->getAlgorithm().getReplicationTracker());
+
+        // Re-elect as soon as the failure detector suspects the leader (or,
+        // in hierarchical mode, the zone's membership changes who it should be)
+        if (service->getAlgorithm().needsElection()) {
+            LOG_INFO("Leader Election", "Current leader is unreachable. Electing a new leader...");
             service->getAlgorithm().electLeader();
-            last_leader_heartbeat = now; // Reset the timeout
         }
 
-        std::this_thread::sleep_for(std::chrono::seconds(5)); // Send heartbeats every 5 seconds
+        // Run the standby copies whose executors the failure detector now suspects
+        service->getAlgorithm().promoteStandbyTasks();
+
+        // Keep a fixed tick period regardless of how long the fan-out took
+        std::this_thread::sleep_until(tick_start + std::chrono::milliseconds(heartbeat_interval_ms));
     }
 }
 
 void RunServer(const std::string& server_id,
                const std::string& bind_address,
-               const std::vector<std::string>& peer_addresses) {
-    std::cout << "[Server] ID: " << server_id << ", Binding on: " << bind_address << std::endl;
+               const std::vector<std::string>& peer_specs) {
+    LOG_INFO("Server", "ID: ", server_id, ", Binding on: ", bind_address);
+
+    // Peers are "<server_id>=<address>". Routing, the failure detector and the
+    // affinity ring know peers by server id, so only named peers get startup
+    // ids; a bare address joins once its first heartbeat reply names it.
+    std::vector<std::string> peer_addresses;
+    std::vector<std::pair<std::string, std::string>> named_peers; // server id, address
+    for (const auto& spec : peer_specs) {
+        size_t separator = spec.find('=');
+        if (separator == std::string::npos) {
+            LOG_WARN("Server", "Peer ", spec, " has no server id; it is not routed to until it answers a heartbeat");
+            peer_addresses.push_back(spec);
+        } else {
+            named_peers.emplace_back(spec.substr(0, separator), spec.substr(separator + 1));
+            peer_addresses.push_back(named_peers.back().second);
+        }
+    }
+
+    // One long-lived channel per peer, shared by heartbeats, task stealing and replication
+    PeerConnectionManager peer_connections(peer_addresses);
+    std::vector<std::string> peers;
+    for (const auto& [peer_id, address] : named_peers) {
+        peer_connections.bindServerId(address, peer_id);
+        peers.push_back(peer_id);
+    }
 
-    TARServiceImpl* service = new TARServiceImpl(server_id, peer_addresses);
+    TARServiceImpl* service = new TARServiceImpl(server_id, peers, &peer_connections);
 
     grpc::EnableDefaultHealthCheckService(true);
     grpc::reflection::InitProtoReflectionServerBuilderPlugin();
 
     grpc::ServerBuilder builder;
     builder.AddListeningPort(bind_address, grpc::InsecureServerCredentials());
-    builder.RegisterService(service);
+
+    // ASYNC_SERVER=1 serves RPCs from completion queues instead of the sync thread pool
+    std::unique_ptr<AsyncTARServer> async_server;
+    if (GetEnvOrDefault("ASYNC_SERVER", 0)) {
+        int num_cores = std::max(1u, std::thread::hardware_concurrency());
+        async_server = std::make_unique<AsyncTARServer>(
+            service,
+            GetEnvOrDefault("ASYNC_SERVER_CQS", num_cores),
+            GetEnvOrDefault("ASYNC_SERVER_THREADS_PER_CQ", 1),
+            GetEnvOrDefault("ASYNC_SERVER_PIN_THREADS", 0) != 0,
+            GetEnvOrDefault("ASYNC_SERVER_ROUTE_THREADS", 4 * num_cores));
+        async_server->configure(builder);
+    } else {
+        builder.RegisterService(service);
+    }
 
     std::unique_ptr<grpc::Server> server(builder.BuildAndStart());
 
     if (!server) {
-        std::cerr << "[Error] Failed to start gRPC server on " << bind_address << std::endl;
+        LOG_ERROR("Server", "Failed to start gRPC server on ", bind_address);
         return;
     }
 
-    std::cout << "[Server] Running on " << bind_address << std::endl;
+    if (async_server) {
+        async_server->start();
+    }
+
+    LOG_INFO("Server", "Running on ", bind_address);
+
+    // Drain the local queue; EXECUTOR_THREADS=0 leaves tasks queued
+    std::unique_ptr<TaskExecutor> executor;
+    int executor_threads = GetEnvOrDefault("EXECUTOR_THREADS", 2);
+    if (executor_threads > 0) {
+        executor = std::make_unique<TaskExecutor>(&service->getAlgorithm(), &peer_connections,
+                                                  TaskExecutor::SyntheticHandler, executor_threads,
+                                                  GetEnvOrDefault("EXECUTOR_PREFETCH", 2));
+        executor->start();
+    }
+
+    // Batch stealing runs on its own trigger, independent of the heartbeat tick
+    TaskStealer stealer(&peer_connections, service);
+    stealer.start();
 
     // Start a single thread to send heartbeats
-    std::thread heartbeat_thread(SendHeartbeats, server_id, peer_addresses, service);
+    std::thread heartbeat_thread(SendHeartbeats, &peer_connections, service, &stealer);
 
     // Wait for the server to shut down
     server->Wait();
@@ -144,11 +316,20 @@ void RunServer(const std::string& server_id,
     // Stop the heartbeat thread when the server shuts down
     keep_sending_heartbeats = false;
     heartbeat_thread.join();
+    stealer.stop();
+    if (executor) {
+        executor->stop();
+    }
+
+    if (async_server) {
+        async_server->shutdown();
+    }
+    Logger::instance().flush();
 }
 
 int main(int argc, char** argv) {
     if (argc < 4) {
-        std::cerr << "Usage: " << argv[0] << " <server_id> <bind_address> <peer1> [peer2] ..." << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <server_id> <bind_address> <peer_id>=<peer_address> ..." << std::endl;
         return 1;
     }
 
@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Simulator.hpp"
+
+// Reads a recorded workload: one arrival per line as
+//   <time_ms> <priority 0-2> [node index]
+// Lines starting with '#' are ignored; without a node index the arrival goes
+// to a node picked by the simulator.
+static bool LoadWorkload(const std::string& path, std::vector<SimArrival>* arrivals) {
+    std::ifstream in(path);
+    if (!in) return false;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        double time_ms;
+        int priority;
+        int node = -1;
+        if (!(fields >> time_ms >> priority)) continue;
+        fields >> node;
+        if (!tar::Priority_IsValid(priority)) continue;
+        arrivals->push_back(SimArrival{std::chrono::nanoseconds(static_cast<int64_t>(time_ms * 1e6)),
+                                       static_cast<tar::Priority>(priority), node});
+    }
+    std::stable_sort(arrivals->begin(), arrivals->end(),
+                     [](const SimArrival& a, const SimArrival& b) { return a.at < b.at; });
+    return true;
+}
+
+int main(int argc, char** argv) {
+    // Per-node INFO lines (one per leader election) would swamp the report
+    setenv("LOG_LEVEL", "2", 0);
+
+    SimConfig config;
+    Simulator simulator(config);
+
+    if (argc > 1) {
+        std::vector<SimArrival> arrivals;
+        if (!LoadWorkload(argv[1], &arrivals)) {
+            std::cerr << "Usage: " << argv[0] << " [workload_file]" << std::endl;
+            std::cerr << "Cannot read workload file: " << argv[1] << std::endl;
+            return 1;
+        }
+        simulator.setWorkload(std::move(arrivals));
+    }
+
+    simulator.run();
+    simulator.report();
+    return 0;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+// Minimal assertion for the unit tests: unlike assert() it stays on in
+// release builds, and it reports the failing expression and line.
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            std::exit(1);                                                             \
+        }                                                                             \
+    } while (0)
+
+#define RUN_TEST(test)                      \
+    do {                                    \
+        test();                             \
+        std::printf("[ OK ] %s\n", #test);  \
+    } while (0)
@@ -0,0 +1,133 @@
+#include "ReplicationTracker.hpp"
+#include "Check.hpp"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::chrono::milliseconds;
+
+static void QuorumSizes() {
+    CHECK(ReplicationTracker::quorumFor(tar::Priority::URGENT, 3) == 2);
+    CHECK(ReplicationTracker::quorumFor(tar::Priority::MODERATE, 2) == 1);
+    CHECK(ReplicationTracker::quorumFor(tar::Priority::LOW, 2) == 1);
+}
+
+static void QuorumIsReachedByAcks() {
+    ReplicationTracker tracker;
+    CHECK(tracker.track("a", tar::Priority::URGENT, 3, true));
+    CHECK(tracker.recordAck("a", true));
+    CHECK(tracker.recordAck("a", false));
+    CHECK(tracker.recordAck("a", true));
+    CHECK(tracker.waitForQuorum("a", milliseconds(10)));
+    CHECK(tracker.quorumLatency(tar::Priority::URGENT).count == 1);
+
+    // Released by the waiter, so late acks are ignored
+    CHECK(!tracker.recordAck("a", true));
+}
+
+static void DuplicateIdIsRejectedAndLeavesTheEntryAlone() {
+    ReplicationTracker tracker;
+    CHECK(tracker.track("a", tar::Priority::URGENT, 3, true));
+    CHECK(!tracker.track("a", tar::Priority::LOW, 1, true));
+
+    // Still the URGENT entry: one ack is not a quorum of three
+    CHECK(tracker.recordAck("a", true));
+    CHECK(!tracker.waitForQuorum("a", milliseconds(10)));
+
+    // Released by the waiter, so the id can be tracked again
+    CHECK(tracker.track("a", tar::Priority::URGENT, 3, true));
+    CHECK(tracker.recordAck("a", true));
+    CHECK(tracker.recordAck("a", true));
+    CHECK(tracker.waitForQuorum("a", milliseconds(10)));
+}
+
+static void UntrackedIdsAreNeverCommitted() {
+    ReplicationTracker tracker;
+    CHECK(!tracker.recordAck("missing", true));
+    CHECK(!tracker.waitForQuorum("missing", milliseconds(1)));
+}
+
+static void UnreachableQuorumFailsWithoutWaiting() {
+    ReplicationTracker tracker;
+    CHECK(tracker.track("a", tar::Priority::URGENT, 3, true));
+    CHECK(tracker.recordAck("a", false));
+    CHECK(tracker.recordAck("a", false));
+
+    auto start = std::chrono::steady_clock::now();
+    CHECK(!tracker.waitForQuorum("a", milliseconds(5000)));
+    CHECK(std::chrono::steady_clock::now() - start < milliseconds(1000));
+}
+
+static void UnawaitedEntryIsDroppedOnceEveryReplicaAnswered() {
+    ReplicationTracker tracker;
+    CHECK(tracker.track("lazy", tar::Priority::LOW, 2, false));
+    CHECK(tracker.recordAck("lazy", true));
+    CHECK(tracker.recordAck("lazy", true));
+    CHECK(!tracker.recordAck("lazy", true));
+    CHECK(tracker.track("lazy", tar::Priority::LOW, 2, false));
+}
+
+static void ConcurrentWaitersOnOneIdDoNotCrash() {
+    // The second waiter finds the entry gone (or still there) but never
+    // touches a released one
+    ReplicationTracker tracker;
+    CHECK(tracker.track("a", tar::Priority::URGENT, 2, true));
+    std::atomic<int> committed{0};
+    std::vector<std::thread> waiters;
+    for (int i = 0; i < 2; ++i) {
+        waiters.emplace_back([&] {
+            if (tracker.waitForQuorum("a", milliseconds(500))) committed.fetch_add(1);
+        });
+    }
+    std::this_thread::sleep_for(milliseconds(20));
+    tracker.recordAck("a", true);
+    tracker.recordAck("a", true);
+    for (auto& waiter : waiters) waiter.join();
+    CHECK(committed.load() >= 1);
+    CHECK(tracker.track("a", tar::Priority::URGENT, 2, true));
+}
+
+static void ConcurrentIdsAcrossThreads() {
+    // Submitters, some reusing ids, race ack threads; every accepted id commits
+    // exactly once and duplicates are refused while the first is in flight
+    ReplicationTracker tracker;
+    const int kThreads = 8;
+    const int kTasks = 500;
+    std::atomic<int> accepted{0};
+    std::atomic<int> committed{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < kTasks; ++i) {
+                // Pairs of threads share ids
+                std::string id = "t" + std::to_string(t / 2) + "-" + std::to_string(i);
+                if (!tracker.track(id, tar::Priority::URGENT, 3, true)) continue;
+                accepted.fetch_add(1);
+                std::thread acker([&tracker, id] {
+                    tracker.recordAck(id, true);
+                    tracker.recordAck(id, true);
+                    tracker.recordAck(id, true);
+                });
+                if (tracker.waitForQuorum(id, milliseconds(5000))) committed.fetch_add(1);
+                acker.join();
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    CHECK(accepted.load() >= kThreads / 2 * kTasks);
+    CHECK(committed.load() == accepted.load());
+}
+
+int main() {
+    RUN_TEST(QuorumSizes);
+    RUN_TEST(QuorumIsReachedByAcks);
+    RUN_TEST(DuplicateIdIsRejectedAndLeavesTheEntryAlone);
+    RUN_TEST(UntrackedIdsAreNeverCommitted);
+    RUN_TEST(UnreachableQuorumFailsWithoutWaiting);
+    RUN_TEST(UnawaitedEntryIsDroppedOnceEveryReplicaAnswered);
+    RUN_TEST(ConcurrentWaitersOnOneIdDoNotCrash);
+    RUN_TEST(ConcurrentIdsAcrossThreads);
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include "TaskLog.hpp"
+#include "Check.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+static tar::Task MakeTask(const std::string& id) {
+    tar::Task task;
+    task.set_id(id);
+    task.set_priority(tar::Priority::MODERATE);
+    task.set_payload("payload of " + id);
+    return task;
+}
+
+static std::vector<std::string> Ids(const std::vector<tar::Task>& tasks) {
+    std::vector<std::string> ids;
+    for (const auto& task : tasks) ids.push_back(task.id());
+    return ids;
+}
+
+static TaskLog::Options SmallLog() {
+    TaskLog::Options options;
+    options.initial_size = 1u << 20;
+    return options;
+}
+
+static std::string TempLogPath(const std::string& name) {
+    char dir[] = "/tmp/tar_task_log_test.XXXXXX";
+    CHECK(mkdtemp(dir) != nullptr);
+    return std::string(dir) + "/" + name;
+}
+
+static void RemoveLog(const std::string& path) {
+    unlink(path.c_str());
+    rmdir(path.substr(0, path.rfind('/')).c_str());
+}
+
+static std::string ReadFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void WriteFile(const std::string& path, const std::string& contents) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), contents.size());
+    CHECK(out.good());
+}
+
+// Logs a, b and c, then removes b; c is the last record of the log
+static void WriteThreeTasks(const std::string& path) {
+    std::vector<tar::Task> recovered;
+    auto log = TaskLog::open(path, SmallLog(), &recovered);
+    CHECK(log && recovered.empty());
+    log->append(MakeTask("a"));
+    log->append(MakeTask("b"));
+    log->remove("b");
+    log->append(MakeTask("c"));
+    log->waitDurable();
+}
+
+static void RecoversLiveTasksInLogOrder() {
+    std::string path = TempLogPath("tasks.log");
+    WriteThreeTasks(path);
+
+    std::vector<tar::Task> recovered;
+    auto log = TaskLog::open(path, SmallLog(), &recovered);
+    CHECK(log);
+    CHECK(Ids(recovered) == (std::vector<std::string>{"a", "c"}));
+    CHECK(recovered[1].payload() == "payload of c");
+    CHECK(log->liveTasks() == 2);
+    log.reset();
+    RemoveLog(path);
+}
+
+static void CorruptTailRecordIsDropped() {
+    std::string path = TempLogPath("tasks.log");
+    WriteThreeTasks(path);
+
+    // A crash mid-write leaves the last record's bytes half old, half new
+    std::string contents = ReadFile(path);
+    size_t payload = contents.rfind("payload of c");
+    CHECK(payload != std::string::npos);
+    contents[payload + 3] ^= 0x5a;
+    WriteFile(path, contents);
+
+    std::vector<tar::Task> recovered;
+    auto log = TaskLog::open(path, SmallLog(), &recovered);
+    CHECK(log);
+    CHECK(Ids(recovered) == std::vector<std::string>{"a"});
+    log.reset();
+    RemoveLog(path);
+}
+
+static void TruncatedTailRecordIsDropped() {
+    std::string path = TempLogPath("tasks.log");
+    WriteThreeTasks(path);
+
+    // The file ends inside the last record, as after a crash before it was extended
+    std::string contents = ReadFile(path);
+    size_t payload = contents.rfind("payload of c");
+    CHECK(payload != std::string::npos);
+    WriteFile(path, contents.substr(0, payload + 4));
+
+    std::vector<tar::Task> recovered;
+    auto log = TaskLog::open(path, SmallLog(), &recovered);
+    CHECK(log);
+    CHECK(Ids(recovered) == std::vector<std::string>{"a"});
+    log.reset();
+    RemoveLog(path);
+}
+
+static void AppendsAfterATornTailSurviveTheNextRestart() {
+    std::string path = TempLogPath("tasks.log");
+    WriteThreeTasks(path);
+    std::string contents = ReadFile(path);
+    contents[contents.rfind("payload of c") + 3] ^= 0x5a;
+    WriteFile(path, contents);
+
+    // New records go where the torn one was and must not run into its remains
+    {
+        std::vector<tar::Task> recovered;
+        auto log = TaskLog::open(path, SmallLog(), &recovered);
+        CHECK(log);
+        log->append(MakeTask("d"));
+        log->waitDurable();
+    }
+
+    std::vector<tar::Task> recovered;
+    auto log = TaskLog::open(path, SmallLog(), &recovered);
+    CHECK(log);
+    CHECK(Ids(recovered) == (std::vector<std::string>{"a", "d"}));
+    log.reset();
+    RemoveLog(path);
+}
+
+int main() {
+    RUN_TEST(RecoversLiveTasksInLogOrder);
+    RUN_TEST(CorruptTailRecordIsDropped);
+    RUN_TEST(TruncatedTailRecordIsDropped);
+    RUN_TEST(AppendsAfterATornTailSurviveTheNextRestart);
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include "TaskQueue.hpp"
+#include "Check.hpp"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+static tar::Task MakeTask(const std::string& id, tar::Priority priority, int64_t deadline = 0, int hop_count = 0) {
+    tar::Task task;
+    task.set_id(id);
+    task.set_priority(priority);
+    task.set_deadline(deadline);
+    task.set_hop_count(hop_count);
+    return task;
+}
+
+static std::vector<std::string> PopAll(TaskQueue& queue) {
+    std::vector<std::string> ids;
+    while (auto task = queue.pop()) ids.push_back(task->id());
+    return ids;
+}
+
+static void PopsByPriorityThenDeadline() {
+    TaskQueue queue;
+    queue.push(MakeTask("low", tar::Priority::LOW, 100));
+    queue.push(MakeTask("moderate-late", tar::Priority::MODERATE, 300));
+    queue.push(MakeTask("moderate-none", tar::Priority::MODERATE)); // No deadline sorts last
+    queue.push(MakeTask("urgent", tar::Priority::URGENT, 900));
+    queue.push(MakeTask("moderate-early", tar::Priority::MODERATE, 200));
+    CHECK(queue.size() == 5);
+    CHECK(queue.size(tar::Priority::MODERATE) == 3);
+
+    auto ids = PopAll(queue);
+    std::vector<std::string> expected = {"urgent", "moderate-early", "moderate-late", "moderate-none", "low"};
+    CHECK(ids == expected);
+    CHECK(queue.size() == 0);
+}
+
+static void EqualDeadlinesPopInArrivalOrder() {
+    // Enough tasks to land in every shard
+    TaskQueue queue;
+    for (int i = 0; i < 100; ++i) queue.push(MakeTask("t" + std::to_string(i), tar::Priority::MODERATE, 50));
+    auto ids = PopAll(queue);
+    CHECK(ids.size() == 100);
+    for (int i = 0; i < 100; ++i) CHECK(ids[i] == "t" + std::to_string(i));
+}
+
+static void ReplacedTaskPopsOnceWithItsNewPlace() {
+    TaskQueue queue;
+    queue.push(MakeTask("a", tar::Priority::LOW, 10));
+    queue.push(MakeTask("b", tar::Priority::MODERATE, 20));
+    queue.push(MakeTask("a", tar::Priority::URGENT, 30)); // Leaves a stale LOW entry behind
+    CHECK(queue.size() == 2);
+    CHECK(queue.size(tar::Priority::LOW) == 0);
+
+    auto first = queue.pop();
+    CHECK(first && first->id() == "a" && first->priority() == tar::Priority::URGENT);
+    auto ids = PopAll(queue);
+    CHECK(ids == std::vector<std::string>{"b"});
+}
+
+static void RemovedTasksAreSkipped() {
+    TaskQueue queue;
+    for (int i = 0; i < 10; ++i) queue.push(MakeTask("t" + std::to_string(i), tar::Priority::MODERATE, 100 + i));
+    CHECK(queue.remove("t0"));
+    CHECK(queue.remove("t5"));
+    CHECK(!queue.remove("t5"));
+    CHECK(!queue.remove("missing"));
+    CHECK(queue.size() == 8);
+
+    auto ids = PopAll(queue);
+    CHECK(ids.size() == 8);
+    CHECK(std::find(ids.begin(), ids.end(), "t0") == ids.end());
+    CHECK(std::find(ids.begin(), ids.end(), "t5") == ids.end());
+    CHECK(std::is_sorted(ids.begin(), ids.end()));
+}
+
+static void ManyStaleEntriesKeepOrder() {
+    // Each round replaces every task, so the heaps carry mostly stale entries
+    // until they are compacted; pops must still see one live copy of each
+    TaskQueue queue;
+    const int kTasks = 200;
+    for (int round = 0; round < 20; ++round) {
+        for (int i = 0; i < kTasks; ++i) {
+            queue.push(MakeTask("t" + std::to_string(i), tar::Priority::LOW, 1000 - i + round));
+        }
+    }
+    for (int i = 0; i < kTasks; i += 2) CHECK(queue.remove("t" + std::to_string(i)));
+    CHECK(queue.size() == kTasks / 2);
+
+    int64_t last = 0;
+    size_t popped = 0;
+    while (auto task = queue.pop()) {
+        CHECK(task->deadline() >= last);
+        last = task->deadline();
+        ++popped;
+    }
+    CHECK(popped == kTasks / 2);
+}
+
+static void TransferSkipsTasksAtTheHopLimit() {
+    TaskQueue queue;
+    queue.push(MakeTask("tired", tar::Priority::URGENT, 10, 3));
+    queue.push(MakeTask("fresh", tar::Priority::MODERATE, 20, 0));
+    auto task = queue.takeTransferable(3);
+    CHECK(task && task->id() == "fresh");
+    CHECK(!queue.takeTransferable(3));
+    CHECK(queue.size() == 1);
+}
+
+static void StealersTakeTheLeastUrgentTasks() {
+    TaskQueue queue;
+    for (int i = 0; i < 400; ++i) {
+        queue.push(MakeTask("m" + std::to_string(i), tar::Priority::MODERATE, 1000 + (i * 37) % 400));
+    }
+    for (int i = 0; i < 20; ++i) queue.push(MakeTask("l" + std::to_string(i), tar::Priority::LOW, 1));
+    queue.push(MakeTask("pinned", tar::Priority::LOW, 5000, 3));
+
+    // Every LOW task that may move goes first, then the latest MODERATE deadlines
+    auto batch = queue.takeTransferableBatch(3, 60);
+    CHECK(batch.size() == 60);
+    size_t low = 0;
+    int64_t earliest_moderate = INT64_MAX;
+    for (const auto& task : batch) {
+        CHECK(task.id() != "pinned");
+        if (task.priority() == tar::Priority::LOW) {
+            ++low;
+        } else {
+            earliest_moderate = std::min<int64_t>(earliest_moderate, task.deadline());
+        }
+    }
+    CHECK(low == 20);
+    // Each shard gives its share, so the cut is only approximately the 40 latest
+    CHECK(earliest_moderate >= 1000 + 400 - 2 * 40);
+
+    // What is left still pops in deadline order
+    int64_t last = 0;
+    size_t left = 0;
+    while (auto task = queue.pop()) {
+        if (task->priority() == tar::Priority::MODERATE) {
+            CHECK(task->deadline() >= last);
+            last = task->deadline();
+        }
+        ++left;
+    }
+    CHECK(left == 421 - 60);
+}
+
+static void PopsAndStealsTakeEachTaskOnce() {
+    // Pops and steals work from opposite ends of two heaps over the same tasks;
+    // whatever one takes must be gone from the other
+    TaskQueue queue;
+    const int kTasks = 600;
+    for (int i = 0; i < kTasks; ++i) queue.push(MakeTask("t" + std::to_string(i), tar::Priority::MODERATE, 1 + i));
+    queue.push(MakeTask("t7", tar::Priority::MODERATE, 5000)); // Replaced: now the latest deadline
+
+    std::vector<std::string> seen;
+    for (int round = 0; round < 4; ++round) {
+        for (int i = 0; i < 50; ++i) seen.push_back(queue.pop()->id());
+        for (const auto& task : queue.takeTransferableBatch(3, 100)) seen.push_back(task.id());
+    }
+    CHECK(std::find(seen.begin(), seen.end(), "t7") != seen.end());
+    CHECK(queue.size() == kTasks - seen.size());
+    auto rest = PopAll(queue);
+    seen.insert(seen.end(), rest.begin(), rest.end());
+    std::sort(seen.begin(), seen.end());
+    CHECK(seen.size() == kTasks);
+    CHECK(std::adjacent_find(seen.begin(), seen.end()) == seen.end());
+}
+
+int main() {
+    RUN_TEST(PopsByPriorityThenDeadline);
+    RUN_TEST(EqualDeadlinesPopInArrivalOrder);
+    RUN_TEST(ReplacedTaskPopsOnceWithItsNewPlace);
+    RUN_TEST(RemovedTasksAreSkipped);
+    RUN_TEST(ManyStaleEntriesKeepOrder);
+    RUN_TEST(TransferSkipsTasksAtTheHopLimit);
+    RUN_TEST(StealersTakeTheLeastUrgentTasks);
+    RUN_TEST(PopsAndStealsTakeEachTaskOnce);
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include "TARAlgorithm.hpp"
+#include "Clock.hpp"
+#include "Check.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+
+static std::string ReadFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static size_t CountOf(const std::string& haystack, const std::string& needle) {
+    size_t count = 0;
+    for (size_t at = haystack.find(needle); at != std::string::npos; at = haystack.find(needle, at + 1)) ++count;
+    return count;
+}
+
+static void RestartsDoNotRelogRecoveredTasks() {
+    char dir[] = "/tmp/tar_task_recovery_test.XXXXXX";
+    CHECK(mkdtemp(dir) != nullptr);
+    setenv("TASK_LOG_DIR", dir, 1);
+    std::string path = std::string(dir) + "/tasks-s1.log";
+
+    {
+        TARAlgorithm algorithm("s1", {"s2"}, ClockSource::real());
+        for (const char* id : {"a", "b"}) {
+            tar::Task task;
+            task.set_id(id);
+            task.set_priority(tar::Priority::MODERATE);
+            task.set_payload(std::string("payload of ") + id);
+            algorithm.addTaskToQueue(std::move(task));
+        }
+        algorithm.waitForDurability();
+    }
+
+    // Each restart recovers both tasks from the log without writing them again
+    for (int restart = 0; restart < 3; ++restart) {
+        TARAlgorithm algorithm("s1", {"s2"}, ClockSource::real());
+        CHECK(algorithm.getTaskQueueLength() == 2);
+        algorithm.waitForDurability();
+    }
+    std::string contents = ReadFile(path);
+    CHECK(CountOf(contents, "payload of a") == 1);
+    CHECK(CountOf(contents, "payload of b") == 1);
+
+    unlink(path.c_str());
+    rmdir(dir);
+}
+
+int main() {
+    setenv("LOG_LEVEL", "3", 1);
+    RUN_TEST(RestartsDoNotRelogRecoveredTasks);
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "Simulator.hpp"
+#include "Check.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using std::chrono::milliseconds;
+
+// Zone summaries live for three heartbeat intervals of the server's wall
+// clock; the simulator's virtual clock makes their expiry exact
+static const int kHeartbeatIntervalMs = 1000;
+
+static tar::ServerMetrics MetricsWithZoneLoad(const std::string& sender, const std::string& zone,
+                                              int64_t updated_at, int64_t now) {
+    tar::ServerMetrics metrics;
+    metrics.set_server_id(sender);
+    metrics.set_last_heartbeat(now);
+    metrics.set_zone("b");
+    tar::ZoneLoad* load = metrics.add_zone_loads();
+    load->set_zone(zone);
+    load->set_members(2);
+    load->set_queue_length(7);
+    load->set_updated_at(updated_at);
+    return metrics;
+}
+
+static bool HasZone(const std::vector<tar::ZoneLoad>& loads, const std::string& zone) {
+    return std::any_of(loads.begin(), loads.end(), [&](const tar::ZoneLoad& load) { return load.zone() == zone; });
+}
+
+static void SummariesExpireAfterThreeIntervals() {
+    VirtualClock clock;
+    clock.advanceTo(std::chrono::seconds(10));
+    TARAlgorithm algorithm("s1", {"s2"}, clock);
+
+    int64_t sent = clock.wallNanos();
+    algorithm.updateServerMetrics(MetricsWithZoneLoad("s2", "c", sent, sent),
+                                  TARAlgorithm::MetricsSource::kHeartbeatReply);
+    CHECK(HasZone(algorithm.getZoneLoads(), "c"));
+
+    clock.advanceTo(clock.elapsed() + milliseconds(3 * kHeartbeatIntervalMs - 100));
+    CHECK(HasZone(algorithm.getZoneLoads(), "c"));
+
+    clock.advanceTo(clock.elapsed() + milliseconds(200));
+    CHECK(!HasZone(algorithm.getZoneLoads(), "c"));
+}
+
+static void StaleInferredZoneNamesAreDropped() {
+    // An inferred zone is named after its leader; when the leader changes, the
+    // old name stops being refreshed and must age out rather than linger
+    VirtualClock clock;
+    clock.advanceTo(std::chrono::seconds(10));
+    TARAlgorithm algorithm("s1", {"s2"}, clock);
+
+    int64_t first = clock.wallNanos();
+    algorithm.updateServerMetrics(MetricsWithZoneLoad("s2", "s7", first, first),
+                                  TARAlgorithm::MetricsSource::kHeartbeatReply);
+
+    clock.advanceTo(clock.elapsed() + milliseconds(4 * kHeartbeatIntervalMs));
+    int64_t later = clock.wallNanos();
+    algorithm.updateServerMetrics(MetricsWithZoneLoad("s2", "s8", later, later),
+                                  TARAlgorithm::MetricsSource::kHeartbeatReply);
+
+    auto loads = algorithm.getZoneLoads();
+    CHECK(HasZone(loads, "s8"));
+    CHECK(!HasZone(loads, "s7"));
+
+    // A late copy of the dropped summary cannot bring it back once it is too old
+    algorithm.updateServerMetrics(MetricsWithZoneLoad("s2", "s7", first, later + 1),
+                                  TARAlgorithm::MetricsSource::kHeartbeatReply);
+    CHECK(!HasZone(algorithm.getZoneLoads(), "s7"));
+}
+
+int main() {
+    setenv("HIERARCHICAL", "1", 1);
+    setenv("ZONE", "a", 1);
+    setenv("HEARTBEAT_INTERVAL_MS", std::to_string(kHeartbeatIntervalMs).c_str(), 1);
+    setenv("LOG_LEVEL", "3", 1);
+    RUN_TEST(SummariesExpireAfterThreeIntervals);
+    RUN_TEST(StaleInferredZoneNamesAreDropped);
+    return 0;
+}